@@ -0,0 +1,177 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "app.h"
+#include "snapshot.h"
+#include "dataset.h"
+
+#define BENCH_OPS 10000
+#define BENCH_KEYS 2000
+#define BENCH_FRAMES 200
+#define BENCH_SAVES 5
+#define BENCH_STRING_ITEMS 10000000
+#define BENCH_ROWS 48
+#define BENCH_COLS 120
+
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void bench_report(const char *name, int items, long ops, double elapsed) {
+    printf("{\"version\":\"%s\",\"bench\":\"%s\",\"items\":%d,\"ops\":%ld,"
+        "\"ns_per_op\":%.1f}\n", TODO_VERSION, name, items, ops, elapsed / ops);
+}
+
+void bench_frame(int full) {
+    if (full) frame_invalidate(&state.frame);
+
+    render_screen();
+    frame_commit(&state.frame, state.output.length);
+    buffer_reset(&state.output);
+}
+
+void bench_edit(const char *name, int items, int at) {
+    double start = bench_now();
+
+    for (int i = 0; i < BENCH_OPS; i++) {
+        push_todo(at, "benchmark item", 14, 0);
+        remove_todo(at);
+    }
+
+    bench_report(name, items, BENCH_OPS * 2, bench_now() - start);
+}
+
+void bench_keys(const char *name, int items, int render) {
+    state.cursor.y = state.stats.count / 2;
+    process_key('e');
+    bench_frame(1);
+
+    double start = bench_now();
+
+    for (int i = 0; i < BENCH_KEYS; i++) {
+        process_key('a' + i % 26);
+        if (render) bench_frame(0);
+    }
+
+    bench_report(name, items, BENCH_KEYS, bench_now() - start);
+    process_key('\x1b');
+}
+
+void bench_render(const char *name, int items, int full) {
+    state.cursor.y = state.stats.count / 2;
+    bench_frame(1);
+
+    double start = bench_now();
+
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        if (!full) process_key(i % 2 ? ARROW_UP : ARROW_DOWN);
+        bench_frame(full);
+    }
+
+    bench_report(name, items, BENCH_FRAMES, bench_now() - start);
+}
+
+void bench_size(char *filename, int items) {
+    double start = bench_now();
+
+    when_open(filename);
+    bench_report("when_open", items, 1, bench_now() - start);
+
+    start = bench_now();
+    load_all();
+    bench_report("load_all", items, 1, bench_now() - start);
+
+    int rounds = 1 + BENCH_STRING_ITEMS / (items + 1);
+    int length;
+
+    start = bench_now();
+
+    for (int i = 0; i < rounds; i++) free(todos_to_string(&length));
+
+    bench_report("todos_to_string", items, rounds, bench_now() - start);
+
+    start = bench_now();
+
+    for (int i = 0; i < BENCH_SAVES; i++) {
+        when_save();
+        writer_flush(&state.writer);
+    }
+
+    bench_report("when_save", items, BENCH_SAVES, bench_now() - start);
+
+    bench_edit("edit_head", items, 0);
+    bench_edit("edit_middle", items, state.stats.count / 2);
+    bench_edit("edit_tail", items, state.stats.count);
+
+    bench_keys("keystroke", items, 0);
+    bench_keys("keystroke_render", items, 1);
+
+    bench_render("render_full", items, 1);
+    bench_render("render_scroll", items, 0);
+}
+
+void bench_remove(const char *filename, const char *suffix) {
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s%s", filename, suffix);
+    unlink(path);
+}
+
+int main(int argc, char *argv[]) {
+    int defaults[] = { 1000, 100000, 1000000 };
+    int count = argc > 1 ? argc - 1 : (int) (sizeof(defaults) / sizeof(defaults[0]));
+    char directory[] = "/tmp/todo-bench-XXXXXX";
+
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct dataset dataset = DATASET_INIT;
+        char filename[128];
+        int status;
+
+        dataset.count = argc > 1 ? atoi(argv[i + 1]) : defaults[i];
+        snprintf(filename, sizeof(filename), "%s/todos-%d.txt", directory, dataset.count);
+
+        if (dataset_create(filename, &dataset) == -1) {
+            perror("dataset_create");
+            return 1;
+        }
+
+        fflush(stdout);
+
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            init();
+            state.screen_rows = BENCH_ROWS;
+            state.screen_cols = BENCH_COLS;
+            bench_size(filename, dataset.count);
+            fflush(stdout);
+            _exit(0);
+        }
+
+        if (pid == -1 || waitpid(pid, &status, 0) == -1 || status != 0) {
+            fprintf(stderr, "bench failed for %d items\n", dataset.count);
+            return 1;
+        }
+
+        bench_remove(filename, "");
+        bench_remove(filename, JOURNAL_SUFFIX);
+        bench_remove(filename, SNAPSHOT_SUFFIX);
+    }
+
+    rmdir(directory);
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "dataset.h"
+
+uint32_t dataset_next(uint32_t *state) {
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+int dataset_write(FILE *out, const struct dataset *dataset) {
+    const char *words[] = {
+        "deploy", "review", "backup", "rotate", "ticket", "server", "update",
+        "cleanup", "invoice", "meeting", "Release", "patch", "call", "email",
+        "refactor", "groceries", "dentist", "report", "budget", "plan"
+    };
+    int word_count = sizeof(words) / sizeof(words[0]);
+    int span = dataset->max_length - dataset->min_length + 1;
+    uint32_t state = dataset->seed ? dataset->seed : 1;
+    char line[4096];
+
+    if (dataset->min_length < 1 || span < 1 ||
+        dataset->max_length > (int) sizeof(line) - 4) return -1;
+
+    for (int i = 0; i < dataset->count; i++) {
+        int length = dataset->min_length + dataset_next(&state) % span;
+        int done = (int) (dataset_next(&state) % 100) < dataset->done_percent;
+        int at = 2;
+
+        line[0] = done ? '-' : ' ';
+        line[1] = ' ';
+
+        while (at - 2 < length) {
+            const char *word = words[dataset_next(&state) % word_count];
+            int word_length = strlen(word);
+
+            if (at > 2) line[at++] = ' ';
+            if (word_length > length - (at - 2)) word_length = length - (at - 2);
+
+            memcpy(&line[at], word, word_length);
+            at += word_length;
+        }
+
+        if (line[at - 1] == ' ') line[at - 1] = '.';
+
+        line[at++] = '\n';
+
+        if (fwrite(line, 1, at, out) != (size_t) at) return -1;
+    }
+
+    return 0;
+}
+
+int dataset_create(const char *filename, const struct dataset *dataset) {
+    FILE *out = fopen(filename, "w");
+
+    if (out == NULL) return -1;
+
+    int result = dataset_write(out, dataset);
+
+    if (fclose(out) == EOF) result = -1;
+
+    return result;
+}
@@ -0,0 +1,19 @@
+#ifndef TODO_DATASET_H
+#define TODO_DATASET_H
+
+#include <stdio.h>
+
+#define DATASET_INIT { 1000, 8, 80, 30, 1 }
+
+struct dataset {
+    int count;
+    int min_length;
+    int max_length;
+    int done_percent;
+    unsigned int seed;
+};
+
+int dataset_write(FILE *out, const struct dataset *dataset);
+int dataset_create(const char *filename, const struct dataset *dataset);
+
+#endif
@@ -0,0 +1,94 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+#include "list.h"
+
+#define BENCH_OPS 200000
+
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void bench_fill(struct todo_list *list, int count) {
+    list_reserve(list, count);
+
+    for (int i = 0; i < count; i++) {
+        list_insert(list, i, "item", 4, i % 3 == 0);
+    }
+}
+
+int bench_step(int cursor, int count) {
+    cursor += rand() % 5 - 2;
+
+    if (cursor < 0) cursor = 0;
+    if (cursor >= count) cursor = count - 1;
+
+    return cursor;
+}
+
+double bench_list(int count) {
+    struct todo_list list = LIST_INIT;
+    int cursor = count / 2;
+
+    bench_fill(&list, count);
+    list_insert(&list, cursor, "item", 4, 0);
+    list_remove(&list, cursor);
+
+    double start = bench_now();
+
+    for (int i = 0; i < BENCH_OPS; i++) {
+        list_insert(&list, cursor, "item", 4, 0);
+        cursor = bench_step(cursor, count);
+        list_remove(&list, cursor);
+        cursor = bench_step(cursor, count);
+    }
+
+    double elapsed = bench_now() - start;
+
+    list_free(&list);
+
+    return elapsed / (BENCH_OPS * 2);
+}
+
+double bench_flat(int count) {
+    todo *items = malloc(sizeof(todo) * (count + 1));
+    todo item = { 0, "", 0, 0 };
+    int cursor = count / 2;
+    int ops = BENCH_OPS / (count / 1000) + 1;
+
+    for (int i = 0; i < count; i++) items[i] = item;
+
+    double start = bench_now();
+
+    for (int i = 0; i < ops; i++) {
+        memmove(&items[cursor + 1], &items[cursor], sizeof(todo) * (count - cursor));
+        items[cursor] = item;
+        cursor = bench_step(cursor, count);
+        memmove(&items[cursor], &items[cursor + 1], sizeof(todo) * (count - cursor));
+        cursor = bench_step(cursor, count);
+    }
+
+    double elapsed = bench_now() - start;
+
+    free(items);
+
+    return elapsed / (ops * 2);
+}
+
+int main() {
+    int sizes[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+    srand(1);
+    printf("%10s %12s %12s\n", "items", "list ns/op", "flat ns/op");
+
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%10d %12.1f %12.1f\n", sizes[i],
+            bench_list(sizes[i]), bench_flat(sizes[i]));
+    }
+
+    return 0;
+}
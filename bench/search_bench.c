@@ -0,0 +1,101 @@
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "search.h"
+
+#define BENCH_ITEMS 1000000
+#define BENCH_ROUNDS 5
+
+struct item {
+    const char *string;
+    int size;
+};
+
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int naive_find(const char *haystack, int length, const char *needle,
+    int needle_length, int ignore_case) {
+    for (int i = 0; i + needle_length <= length; i++) {
+        int j = 0;
+
+        while (j < needle_length && (ignore_case ?
+            tolower((unsigned char) haystack[i + j]) == tolower((unsigned char) needle[j]) :
+            haystack[i + j] == needle[j])) j++;
+
+        if (j == needle_length) return i;
+    }
+
+    return -1;
+}
+
+double bench_scan(struct item *items, const char *needle, int ignore_case,
+    int (*find)(const char *, int, const char *, int, int), int *matches) {
+    int needle_length = strlen(needle);
+    double start = bench_now();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        *matches = 0;
+
+        for (int i = 0; i < BENCH_ITEMS; i++) {
+            if (find(items[i].string, items[i].size, needle, needle_length,
+                ignore_case) != -1) (*matches)++;
+        }
+    }
+
+    return (bench_now() - start) / BENCH_ROUNDS / 1e6;
+}
+
+int main() {
+    const char *words[] = {
+        "deploy", "review", "backup", "rotate", "ticket", "server",
+        "update", "cleanup", "invoice", "meeting", "Release", "patch"
+    };
+    int word_count = sizeof(words) / sizeof(words[0]);
+    struct item *items = malloc(sizeof(struct item) * BENCH_ITEMS);
+    char *arena = malloc(BENCH_ITEMS * 80);
+    char *p = arena;
+    int matches;
+
+    srand(1);
+
+    for (int i = 0; i < BENCH_ITEMS; i++) {
+        int count = 2 + rand() % 7;
+
+        items[i].string = p;
+
+        for (int w = 0; w < count; w++) {
+            const char *word = words[rand() % word_count];
+            p += sprintf(p, "%s%s", w ? " " : "", word);
+        }
+
+        p += sprintf(p, " #%d", rand() % 100000);
+        items[i].size = p - items[i].string;
+    }
+
+    printf("%-12s %-6s %12s %12s %10s\n", "needle", "case", "simd ms", "naive ms", "matches");
+
+    const char *needles[] = { "release", "Release", "#4242", "zzz" };
+
+    for (unsigned int n = 0; n < sizeof(needles) / sizeof(needles[0]); n++) {
+        int ignore_case = !search_has_upper(needles[n], strlen(needles[n]));
+        double simd = bench_scan(items, needles[n], ignore_case, search_find, &matches);
+        double naive = bench_scan(items, needles[n], ignore_case, naive_find, &matches);
+
+        printf("%-12s %-6s %12.2f %12.2f %10d\n", needles[n],
+            ignore_case ? "smart" : "exact", simd, naive, matches);
+    }
+
+    free(arena);
+    free(items);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dataset.h"
+
+void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n items] [-l min:max] [-d done%%] [-s seed] [file]\n",
+        program);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    struct dataset dataset = DATASET_INIT;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:d:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                dataset.count = atoi(optarg);
+                break;
+            case 'l':
+                if (sscanf(optarg, "%d:%d", &dataset.min_length,
+                    &dataset.max_length) != 2) usage(argv[0]);
+                break;
+            case 'd':
+                dataset.done_percent = atoi(optarg);
+                break;
+            case 's':
+                dataset.seed = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (dataset.count < 0 || optind + 1 < argc) usage(argv[0]);
+
+    int result = optind < argc ? dataset_create(argv[optind], &dataset) :
+        dataset_write(stdout, &dataset);
+
+    if (result == -1) {
+        perror("todo_gen");
+        return 1;
+    }
+
+    return 0;
+}
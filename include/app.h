@@ -0,0 +1,184 @@
+#ifndef TODO_APP_H
+#define TODO_APP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "buffer.h"
+#include "frame.h"
+#include "input.h"
+#include "journal.h"
+#include "list.h"
+#include "loader.h"
+#include "protocol.h"
+#include "rows.h"
+#include "server.h"
+#include "todo.h"
+#include "trace.h"
+#include "trigram.h"
+#include "watch.h"
+#include "writer.h"
+
+#define TODO_VERSION "0.0.1"
+#define TODO_OFFSET 6
+#define TODO_IDLE_TIMEOUT 1000
+#define TODO_FETCH_ITEMS 1024
+#define ctrl_key(k) ((k) & 0x1f)
+
+enum work_modes {
+    WM_NORMAL,
+    WM_INSERT,
+    WM_SEARCH,
+    WM_FILTER
+};
+
+enum view_modes {
+    VIEW_ALL,
+    VIEW_OPEN,
+    VIEW_DONE
+};
+
+enum insertion_modes {
+    IM_AFTER,
+    IM_BEFORE,
+    IM_CURRENT
+};
+
+struct cursor_state {
+    int x;
+    int y;
+};
+
+struct search_state {
+    char query[128];
+    int length;
+    int origin;
+    int matches;
+};
+
+struct filter_state {
+    char query[128];
+    int length;
+    int active;
+    int pending;
+    int *rows;
+    int count;
+    int capacity;
+};
+
+struct todos_stats {
+    int count;
+    int done;
+    int todo;
+};
+
+struct load_state {
+    struct loader loader;
+    int active;
+    int next;
+};
+
+struct merge_save {
+    unsigned long generation;
+    uint64_t *hashes;
+    int count;
+};
+
+struct merge_state {
+    uint64_t *base;
+    int count;
+    struct merge_save *saves;
+    int save_count;
+    int save_capacity;
+    int pending;
+    struct stat seen;
+};
+
+struct remote_op {
+    struct protocol_message message;
+    char *payload;
+    char *anchor;
+    int anchor_length;
+};
+
+struct remote_state {
+    struct protocol_stream stream;
+    char *path;
+    int active;
+    int stale;
+    int resync;
+    uint32_t version;
+    int count;
+    struct remote_op *ops;
+    int op_count;
+    int op_capacity;
+};
+
+struct serve_state {
+    struct server server;
+    char *path;
+    uint32_t version;
+};
+
+struct config_state {
+    struct cursor_state cursor;
+    struct todos_stats stats;
+    struct search_state search;
+    struct filter_state filter;
+    int view;
+    int row_offset;
+    int screen_rows;
+    int screen_cols;
+    int work_mode;
+    int insertion_mode;
+    int insertion_new;
+    char status_message[80];
+    time_t status_message_time;
+    struct todo_list todos;
+    todo editor;
+    char *filename;
+    char *map;
+    size_t map_length;
+    struct journal journal;
+    struct writer writer;
+    int sync;
+    int batch;
+    struct trigram_index trigram;
+    struct load_state load;
+    struct merge_state merge;
+    struct remote_state remote;
+    struct serve_state serve;
+    struct watch watch;
+    struct frame frame;
+    struct row_cache rows;
+    struct buffer output;
+    struct buffer line;
+    struct input input;
+    struct trace trace;
+    int wakeup[2];
+};
+
+extern struct config_state state;
+
+void set_status_message(const char *fmt, ...);
+char *todos_to_string(int *buffer_length);
+void when_save();
+void when_journal(int written);
+int when_changed();
+void clear_screen();
+void push_todo(int at, const char *string, size_t length, int done);
+void toggle_todo(int at);
+void remove_todo(int at);
+void set_todo_text(int at, const char *string, int length);
+void edit_todo();
+void process_key(int c);
+void load_all();
+void render_screen();
+void refresh_screen();
+void when_open(char *filename);
+void wait_for_events();
+void init();
+void init_window();
+
+#endif
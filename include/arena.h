@@ -0,0 +1,46 @@
+#ifndef TODO_ARENA_H
+#define TODO_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_INIT { NULL, 0, NULL, 0, 0, 0, 0, 0, 0, \
+    { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX } }
+#define ARENA_MIN_CAPACITY 4096
+#define ARENA_NONE UINT32_MAX
+#define ARENA_CLASSES 5
+#define ARENA_MIN_CLASS 16
+#define ARENA_SLAB_SIZE 4096
+#define ARENA_COMPACT_SIZE (1 << 16)
+
+struct arena {
+    const char *base;
+    uint32_t base_length;
+    char *heap;
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t live;
+    uint32_t text;
+    uint32_t free;
+    int bulk;
+    uint32_t free_lists[ARENA_CLASSES];
+};
+
+struct arena_stats {
+    size_t live;
+    size_t used;
+    size_t capacity;
+    int fragmentation;
+};
+
+int arena_map(struct arena *arena, const char *base, size_t length);
+void arena_bulk(struct arena *arena, int bulk);
+int arena_reserve(struct arena *arena, uint32_t size);
+uint32_t arena_store(struct arena *arena, const char *string, int length);
+void arena_release(struct arena *arena, uint32_t offset, int length);
+const char *arena_get(const struct arena *arena, uint32_t offset);
+int arena_fragmented(const struct arena *arena);
+void arena_stats(const struct arena *arena, struct arena_stats *stats);
+void arena_free(struct arena *arena);
+
+#endif
@@ -1,12 +1,26 @@
+#ifndef TODO_BUFFER_H
+#define TODO_BUFFER_H
+
 #include <stdlib.h>
 #include <string.h>
 
-#define BUFFER_INIT { NULL, 0 }
+#define BUFFER_INIT { NULL, 0, 0 }
+#define BUFFER_MIN_CAPACITY 256
 
 struct buffer {
     char *string;
     int length;
+    int capacity;
 };
 
+int buffer_reserve(struct buffer *dest, int length);
 void buffer_append(struct buffer *dest, const char *string, int length);
+void buffer_append_char(struct buffer *dest, char c);
+int buffer_format_int(char *dest, long long value);
+void buffer_append_int(struct buffer *dest, int value, int width);
+void buffer_append_cursor(struct buffer *dest, int row, int col);
+void buffer_reset(struct buffer *dest);
+int buffer_flush(struct buffer *src, int fd);
 void buffer_free(struct buffer *target);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TODO_DIFF_H
+#define TODO_DIFF_H
+
+#include <stdint.h>
+
+#define DIFF_MAX_EDITS 1024
+#define DIFF_COARSE 1
+
+struct diff_hunk {
+    int a_start;
+    int a_end;
+    int b_start;
+    int b_end;
+};
+
+uint64_t diff_hash(const char *string, int length, int done);
+int diff_lines(const uint64_t *a, int a_count, const uint64_t *b, int b_count,
+    struct diff_hunk **hunks, int *count);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef TODO_EXPORT_H
+#define TODO_EXPORT_H
+
+#define EXPORT_BLOCK_SIZE (1 << 20)
+
+enum export_formats {
+    EXPORT_TEXT,
+    EXPORT_JSON,
+    EXPORT_CSV
+};
+
+enum export_filters {
+    EXPORT_ALL,
+    EXPORT_OPEN,
+    EXPORT_DONE
+};
+
+struct export_options {
+    int format;
+    int filter;
+    const char *query;
+    int query_length;
+};
+
+int export_stream(int in, int out, const struct export_options *options);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TODO_FRAME_H
+#define TODO_FRAME_H
+
+#include <stdint.h>
+
+#include "buffer.h"
+
+#define FRAME_INIT { NULL, 0, 0, 0, 0, 0, 0 }
+
+struct frame {
+    uint64_t *hashes;
+    int rows;
+    int cols;
+    int valid;
+    int last_bytes;
+    unsigned long total_bytes;
+    unsigned long count;
+};
+
+void frame_resize(struct frame *frame, int rows, int cols);
+void frame_invalidate(struct frame *frame);
+void frame_row(struct frame *frame, struct buffer *dest, int y, struct buffer *row);
+void frame_commit(struct frame *frame, int bytes);
+void frame_free(struct frame *frame);
+
+#endif
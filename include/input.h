@@ -0,0 +1,44 @@
+#ifndef TODO_INPUT_H
+#define TODO_INPUT_H
+
+#include "buffer.h"
+
+#define INPUT_BUFFER_SIZE 4096
+#define INPUT_ESCAPE_TIMEOUT 50
+#define INPUT_PASTE_TIMEOUT 1000
+
+#define PASTE_END "\x1b[201~"
+#define PASTE_END_LENGTH 6
+
+enum keys {
+    TAB_KEY = 9,
+    BACKSPACE = 127,
+    ARROW_LEFT = 1000,
+    ARROW_RIGHT,
+    ARROW_UP,
+    ARROW_DOWN,
+    DEL_KEY,
+    HOME_KEY,
+    END_KEY,
+    PAGE_UP,
+    PAGE_DOWN,
+    ALT_ENTER,
+    SHIFT_TAB,
+    PASTE_BEGIN,
+    PASTE_KEY
+};
+
+struct input {
+    char buffer[INPUT_BUFFER_SIZE];
+    int start;
+    int length;
+    struct buffer paste;
+    int pasting;
+    long received;
+};
+
+int input_read(struct input *input, int fd);
+int input_next(struct input *input, int *key, int final);
+int input_timeout(const struct input *input);
+
+#endif
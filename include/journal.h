@@ -0,0 +1,45 @@
+#ifndef TODO_JOURNAL_H
+#define TODO_JOURNAL_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "buffer.h"
+
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_COMPACT_SIZE (1 << 20)
+
+struct journal_handler {
+    void (*toggle)(int at);
+    void (*insert)(int at, int done, const char *string, int length);
+    void (*remove)(int at);
+    void (*edit)(int at, const char *string, int length);
+};
+
+struct journal {
+    int fd;
+    char *path;
+    size_t length;
+    size_t header_length;
+    size_t recorded;
+    struct buffer batch;
+    int batching;
+};
+
+int journal_open(struct journal *journal, const char *filename,
+    const struct journal_handler *handler);
+int journal_reset(struct journal *journal, int file);
+void journal_close(struct journal *journal);
+int journal_dirty(struct journal *journal);
+void journal_begin(struct journal *journal);
+int journal_commit(struct journal *journal);
+int journal_write(struct journal *journal, const char *string, size_t length);
+
+int journal_toggle(struct journal *journal, int at);
+int journal_insert(struct journal *journal, int at, int done,
+    const char *string, int length);
+int journal_delete(struct journal *journal, int at);
+int journal_edit(struct journal *journal, int at, const char *string, int length);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TODO_LIST_H
+#define TODO_LIST_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "todo.h"
+
+#define LIST_INIT { NULL, NULL, NULL, NULL, NULL, 0, 0, 0, NULL, 0, NULL, 0, 0, ARENA_INIT }
+
+struct todo_list {
+    uint32_t *offsets;
+    uint32_t *lengths;
+    int *ids;
+    uint64_t *done;
+    int *tree;
+    int capacity;
+    int gap_start;
+    int gap_end;
+    int *slots;
+    int id_count;
+    int *free_ids;
+    int free_count;
+    int free_capacity;
+    struct arena arena;
+};
+
+int list_count(const struct todo_list *list);
+todo list_text(const struct todo_list *list, int at);
+int list_done(const struct todo_list *list, int at);
+int list_id(const struct todo_list *list, int at);
+int list_map(struct todo_list *list, const char *base, size_t length);
+int list_insert(struct todo_list *list, int at, const char *string, int length, int done);
+int list_append(struct todo_list *list, const uint32_t *offsets,
+    const uint32_t *lengths, const unsigned char *done, int count);
+int list_set_text(struct todo_list *list, int at, const char *string, int length);
+void list_remove(struct todo_list *list, int at);
+int list_compact(struct todo_list *list);
+void list_reserve(struct todo_list *list, int count);
+void list_set_done(struct todo_list *list, int at, int done);
+int list_rank(const struct todo_list *list, int at, int done);
+int list_select(const struct todo_list *list, int rank, int done);
+int list_index_of(const struct todo_list *list, int id);
+void list_free(struct todo_list *list);
+
+#endif
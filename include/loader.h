@@ -0,0 +1,63 @@
+#ifndef TODO_LOADER_H
+#define TODO_LOADER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#define LOADER_CHUNK_SIZE (1 << 20)
+#define LOADER_CHUNK_ITEMS (1 << 16)
+#define LOADER_MIN_LINES 1024
+#define LOADER_MAX_THREADS 64
+
+enum loader_read_state {
+    LOADER_FAILED = -1,
+    LOADER_UNREAD,
+    LOADER_READING,
+    LOADER_READ
+};
+
+struct loader_chunk {
+    const char *start;
+    const char *end;
+    uint32_t *offsets;
+    uint32_t *lengths;
+    unsigned char *done;
+    int count;
+    int capacity;
+    int done_count;
+    int read;
+    int parsed;
+    int borrowed;
+};
+
+struct loader {
+    const char *base;
+    char *buffer;
+    size_t length;
+    int file;
+    struct loader_chunk *chunks;
+    int chunk_count;
+    int threads;
+    int started;
+    int next;
+    int notify;
+    pthread_t workers[LOADER_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+};
+
+int loader_open(struct loader *loader, int file, size_t length);
+int loader_attach(struct loader *loader, const char *base, size_t length,
+    const uint32_t *offsets, const uint32_t *lengths, const unsigned char *done,
+    int count);
+int loader_parse_chunk(struct loader *loader, int index);
+void loader_start(struct loader *loader, int notify);
+int loader_ready(struct loader *loader, int chunk);
+int loader_wait(struct loader *loader, int chunk);
+int loader_append(struct loader_chunk *chunk, struct todo_list *list);
+void loader_finish(struct loader *loader);
+
+#endif
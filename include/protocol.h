@@ -0,0 +1,59 @@
+#ifndef TODO_PROTOCOL_H
+#define TODO_PROTOCOL_H
+
+#include <stdint.h>
+
+#include "buffer.h"
+
+#define PROTOCOL_SUFFIX ".sock"
+#define PROTOCOL_MAX_PAYLOAD (1 << 28)
+#define PROTOCOL_STREAM_INIT { -1, BUFFER_INIT, BUFFER_INIT, 0 }
+
+enum protocol_types {
+    PROTOCOL_OPEN = 1,
+    PROTOCOL_SUBSCRIBE,
+    PROTOCOL_RANGE,
+    PROTOCOL_INSERT,
+    PROTOCOL_DELETE,
+    PROTOCOL_TOGGLE,
+    PROTOCOL_EDIT,
+    PROTOCOL_STATE,
+    PROTOCOL_ITEMS,
+    PROTOCOL_STALE,
+    PROTOCOL_ERROR,
+    PROTOCOL_ACK
+};
+
+struct protocol_message {
+    uint32_t type;
+    uint32_t version;
+    uint32_t at;
+    uint32_t count;
+    uint32_t done;
+    uint32_t length;
+};
+
+struct protocol_stream {
+    int fd;
+    struct buffer in;
+    struct buffer out;
+    int start;
+};
+
+char *protocol_path(const char *filename);
+int protocol_listen(const char *path);
+int protocol_connect(const char *path);
+
+void protocol_send(struct protocol_stream *stream,
+    const struct protocol_message *message, const char *payload);
+void protocol_item(struct buffer *dest, const char *string, int length, int done);
+const char *protocol_next_item(const char *p, const char *end,
+    const char **string, int *length, int *done);
+
+int protocol_write(struct protocol_stream *stream);
+int protocol_read(struct protocol_stream *stream);
+int protocol_next(struct protocol_stream *stream,
+    struct protocol_message *message, const char **payload);
+void protocol_close(struct protocol_stream *stream);
+
+#endif
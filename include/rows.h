@@ -0,0 +1,27 @@
+#ifndef TODO_ROWS_H
+#define TODO_ROWS_H
+
+#include "buffer.h"
+
+#define ROW_CACHE_INIT { NULL, 0 }
+
+struct row_entry {
+    int index;
+    int key;
+    struct buffer bytes;
+};
+
+struct row_cache {
+    struct row_entry *entries;
+    int slots;
+};
+
+void row_cache_resize(struct row_cache *cache, int slots);
+struct buffer *row_cache_lookup(struct row_cache *cache, int index, int key);
+void row_cache_store(struct row_cache *cache, int index, int key,
+    const struct buffer *bytes);
+void row_cache_invalidate(struct row_cache *cache, int index);
+void row_cache_clear(struct row_cache *cache);
+void row_cache_free(struct row_cache *cache);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TODO_SEARCH_H
+#define TODO_SEARCH_H
+
+int search_find(const char *haystack, int length,
+    const char *needle, int needle_length, int ignore_case);
+int search_has_upper(const char *string, int length);
+
+#endif
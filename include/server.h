@@ -0,0 +1,34 @@
+#ifndef TODO_SERVER_H
+#define TODO_SERVER_H
+
+#include <poll.h>
+
+#include "protocol.h"
+
+#define SERVER_INIT { -1, NULL, NULL, 0, 0 }
+#define SERVER_MAX_OUTPUT (16 << 20)
+
+struct server_client {
+    struct protocol_stream stream;
+    int subscribed;
+    int stale;
+    int lagging;
+};
+
+struct server {
+    int fd;
+    char *path;
+    struct server_client *clients;
+    int count;
+    int capacity;
+};
+
+int server_open(struct server *server, const char *filename);
+int server_accept(struct server *server);
+int server_events(struct server *server, struct pollfd *fds);
+void server_broadcast(struct server *server, int except,
+    const struct protocol_message *message, const char *payload);
+void server_drop(struct server *server, int index);
+void server_close(struct server *server);
+
+#endif
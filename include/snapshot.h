@@ -0,0 +1,40 @@
+#ifndef TODO_SNAPSHOT_H
+#define TODO_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_SUFFIX ".snapshot"
+#define SNAPSHOT_MAGIC "TODOSNP1"
+#define SNAPSHOT_SAMPLES 64
+#define SNAPSHOT_SAMPLE_SIZE 64
+
+struct snapshot_header {
+    char magic[8];
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t inode;
+    uint64_t hash;
+    uint32_t count;
+    uint32_t blob_length;
+};
+
+struct snapshot {
+    char *map;
+    size_t length;
+    int count;
+    const uint32_t *offsets;
+    const uint32_t *lengths;
+    const unsigned char *done;
+};
+
+uint64_t snapshot_hash(const char *text, size_t length);
+int snapshot_write(const char *filename, const char *text, size_t length,
+    const struct stat *st);
+int snapshot_open(struct snapshot *snapshot, const char *filename, int file,
+    const struct stat *st);
+void snapshot_close(struct snapshot *snapshot);
+
+#endif
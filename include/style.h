@@ -0,0 +1,21 @@
+#ifndef TODO_STYLE_H
+#define TODO_STYLE_H
+
+#include "buffer.h"
+
+enum style_flags {
+    STYLE_PLAIN = 0,
+    STYLE_STRIKE = 1 << 0,
+    STYLE_MAGENTA = 1 << 1
+};
+
+struct style {
+    struct buffer *dest;
+    int current;
+};
+
+void style_begin(struct style *style, struct buffer *dest);
+void style_append(struct style *style, int flags, const char *string, int length);
+void style_end(struct style *style);
+
+#endif
@@ -1,4 +1,5 @@
 #include <ctype.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <termios.h>
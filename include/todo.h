@@ -1,6 +1,25 @@
+#ifndef TODO_TODO_H
+#define TODO_TODO_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TODO_MIN_CAPACITY 16
+
 typedef struct todo {
     int size;
     char *string;
-    int done;
+    int capacity;
+    int gap;
 } todo;
 
+int is_todo_line(const char *line, size_t length);
+void todo_own(todo *src);
+void todo_flatten(todo *src);
+const char *todo_span(const todo *src, int at, int *length);
+void todo_insert_text(todo *dest, int at, const char *string, int length);
+void todo_insert_char(todo *dest, int at, int c);
+void todo_del_char(todo *src, int at);
+void free_todo(todo *src);
+
+#endif
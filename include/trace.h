@@ -0,0 +1,46 @@
+#ifndef TODO_TRACE_H
+#define TODO_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_FRAMES 256
+#define TRACE_INIT { 0, 0, NULL, 0, 0, { 0, { 0, 0, 0 } }, { 0 }, 0, 0, { 0, 0, 0 } }
+
+struct trace_counters {
+    unsigned long bytes;
+    unsigned long allocations;
+    unsigned long syscalls;
+};
+
+extern __thread struct trace_counters trace_counters;
+
+struct trace_span {
+    uint64_t start;
+    struct trace_counters counters;
+};
+
+struct trace {
+    int active;
+    int hud;
+    FILE *file;
+    int events;
+    uint64_t origin;
+    struct trace_span frame;
+    uint64_t frames[TRACE_FRAMES];
+    int frame_count;
+    uint64_t last;
+    struct trace_counters last_counters;
+};
+
+uint64_t trace_now();
+int trace_open(struct trace *trace, const char *path);
+void trace_toggle(struct trace *trace);
+void trace_begin(struct trace *trace, struct trace_span *span);
+uint64_t trace_end(struct trace *trace, struct trace_span *span, const char *name);
+void trace_wake(struct trace *trace);
+void trace_frame(struct trace *trace);
+uint64_t trace_percentile(struct trace *trace, int percent);
+void trace_close(struct trace *trace);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TODO_TRIGRAM_H
+#define TODO_TRIGRAM_H
+
+#include "list.h"
+
+#define TRIGRAM_BUCKETS (1 << 16)
+#define TRIGRAM_MIN_STALE (1 << 16)
+
+struct posting {
+    int *ids;
+    int length;
+    int capacity;
+};
+
+struct trigram_index {
+    struct posting *buckets;
+    int *counts;
+    unsigned int *seen;
+    int ids;
+    unsigned int generation;
+    long live;
+    long stale;
+};
+
+#define TRIGRAM_INIT { NULL, NULL, NULL, 0, 0, 0, 0 }
+
+int trigram_init(struct trigram_index *index);
+int trigram_build(struct trigram_index *index, struct todo_list *list);
+void trigram_add(struct trigram_index *index, int id, const todo *text);
+void trigram_insert(struct trigram_index *index, struct todo_list *list, int at);
+void trigram_remove(struct trigram_index *index, int id);
+void trigram_update(struct trigram_index *index, int id, const todo *text);
+int trigram_match(const todo *text, const char *query, int length);
+int trigram_filter(struct trigram_index *index, struct todo_list *list,
+    const char *query, int length, int **rows, int *capacity, int narrow);
+void trigram_free(struct trigram_index *index);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef TODO_WATCH_H
+#define TODO_WATCH_H
+
+#define WATCH_INIT { -1, -1, NULL }
+
+struct watch {
+    int fd;
+    int wd;
+    char *name;
+};
+
+int watch_open(struct watch *watch, const char *filename);
+int watch_changed(struct watch *watch);
+void watch_close(struct watch *watch);
+
+#endif
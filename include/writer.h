@@ -0,0 +1,58 @@
+#ifndef TODO_WRITER_H
+#define TODO_WRITER_H
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "buffer.h"
+#include "journal.h"
+
+#define WRITER_QUIET 200
+#define WRITER_MAX_DELAY 2000
+
+#define WRITER_SYNC_SAVE 0
+#define WRITER_SYNC_EXIT -1
+
+#define WRITER_UNSYNCED_JOURNAL 1
+#define WRITER_UNSYNCED_DIRECTORY 2
+
+struct writer {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_cond_t idle;
+    struct journal *journal;
+    char *filename;
+    char *path;
+    int notify;
+    struct buffer head;
+    struct buffer tail;
+    char *snapshot;
+    int snapshot_length;
+    int saving;
+    unsigned long queued;
+    unsigned long saved;
+    int busy;
+    int flushing;
+    int sync;
+    int unsynced;
+    struct timespec synced;
+    struct stat written;
+    struct timespec first;
+    struct timespec last;
+    int error;
+    char message[80];
+    char failure[80];
+};
+
+int writer_start(struct writer *writer, struct journal *journal,
+    const char *filename, int notify, int sync);
+void writer_record(struct writer *writer, const char *string, int length);
+unsigned long writer_save(struct writer *writer, char *snapshot, int length);
+void writer_flush(struct writer *writer);
+int writer_wrote(struct writer *writer, const struct stat *st);
+unsigned long writer_saved(struct writer *writer);
+int writer_message(struct writer *writer, char *dest, size_t size);
+int writer_error(struct writer *writer, char *dest, size_t size);
+
+#endif
@@ -0,0 +1,2263 @@
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "app.h"
+#include "terminal.h"
+#include "support.h"
+#include "diff.h"
+#include "search.h"
+#include "snapshot.h"
+#include "style.h"
+
+struct config_state state;
+
+void set_status_message(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(state.status_message, sizeof(state.status_message), fmt, ap);
+    va_end(ap);
+    state.status_message_time = time(NULL);
+}
+
+char *todos_to_string(int *buffer_length) {
+    int total_length = 0;
+    int i;
+
+    for (i = 0; i < state.stats.count; i++) {
+        total_length += list_text(&state.todos, i).size + 3;
+    }
+
+    *buffer_length = total_length;
+
+    char *buffer = malloc(total_length);
+    char *p = buffer;
+
+    trace_counters.allocations++;
+
+    for (i = 0; i < state.stats.count; i++) {
+        todo current = list_text(&state.todos, i);
+
+        *p = list_done(&state.todos, i) ? '-' : ' ';
+        p++;
+        *p = ' ';
+        p++;
+        memcpy(p, current.string, current.size);
+        p += current.size;
+        *p = '\n';
+        p++;
+    }
+
+    return buffer;
+}
+
+uint64_t *hash_todos() {
+    uint64_t *hashes = malloc(sizeof(uint64_t) * (state.stats.count + 1));
+
+    if (hashes == NULL) return NULL;
+
+    for (int i = 0; i < state.stats.count; i++) {
+        todo text = list_text(&state.todos, i);
+        hashes[i] = diff_hash(text.string, text.size, list_done(&state.todos, i));
+    }
+
+    return hashes;
+}
+
+void rebase() {
+    free(state.merge.base);
+    state.merge.base = hash_todos();
+    state.merge.count = state.stats.count;
+
+    if (state.merge.base == NULL) die("hash_todos");
+}
+
+void merge_confirm() {
+    unsigned long saved = writer_saved(&state.writer);
+    int confirmed = 0;
+
+    while (confirmed < state.merge.save_count &&
+        state.merge.saves[confirmed].generation <= saved) confirmed++;
+
+    if (confirmed == 0) return;
+
+    struct merge_save *save = &state.merge.saves[confirmed - 1];
+
+    free(state.merge.base);
+    state.merge.base = save->hashes;
+    state.merge.count = save->count;
+
+    for (int i = 0; i < confirmed - 1; i++) free(state.merge.saves[i].hashes);
+
+    state.merge.save_count -= confirmed;
+    memmove(state.merge.saves, &state.merge.saves[confirmed],
+        sizeof(struct merge_save) * state.merge.save_count);
+}
+
+void merge_queue(unsigned long generation) {
+    if (state.merge.save_count == state.merge.save_capacity) {
+        int capacity = state.merge.save_capacity ? state.merge.save_capacity * 2 : 4;
+        struct merge_save *saves = realloc(state.merge.saves,
+            sizeof(struct merge_save) * capacity);
+
+        if (saves == NULL) die("realloc");
+
+        state.merge.saves = saves;
+        state.merge.save_capacity = capacity;
+    }
+
+    uint64_t *hashes = hash_todos();
+
+    if (hashes == NULL) die("hash_todos");
+
+    struct merge_save save = { generation, hashes, state.stats.count };
+    state.merge.saves[state.merge.save_count++] = save;
+}
+
+void when_save() {
+    if (state.filename == NULL || state.remote.active) return;
+
+    struct trace_span span;
+    trace_begin(&state.trace, &span);
+
+    int length;
+    char *buffer = todos_to_string(&length);
+
+    merge_confirm();
+    merge_queue(writer_save(&state.writer, buffer, length));
+    state.journal.recorded = 0;
+
+    trace_end(&state.trace, &span, "when_save");
+}
+
+void when_journal(int written) {
+    if (written <= 0 || state.journal.batching) return;
+
+    writer_record(&state.writer, state.journal.batch.string,
+        state.journal.batch.length);
+    buffer_reset(&state.journal.batch);
+
+    if (state.journal.recorded >= JOURNAL_COMPACT_SIZE) when_save();
+}
+
+void clear_screen() {
+    write(STDOUT_FILENO, "\x1b[2J", 4);
+    write(STDOUT_FILENO, "\x1b[H", 3);
+    write(STDOUT_FILENO, "\x1b[?25h", 6);
+}
+
+void when_quit() {
+    if (journal_dirty(&state.journal)) when_save();
+    if (state.filename != NULL && !state.load.active && !state.remote.active) {
+        writer_flush(&state.writer);
+    }
+    trace_close(&state.trace);
+    clear_screen();
+    exit(0);
+}
+
+int view_count() {
+    if (state.filter.active) return state.filter.count;
+
+    switch (state.view) {
+        case VIEW_OPEN:
+            return state.stats.todo;
+        case VIEW_DONE:
+            return state.stats.done;
+        default:
+            return state.stats.count;
+    }
+}
+
+int view_index(int row) {
+    if (state.filter.active) return state.filter.rows[row];
+    if (state.view == VIEW_ALL) return row;
+
+    return list_select(&state.todos, row, state.view == VIEW_DONE);
+}
+
+int view_rank(int at) {
+    if (!state.filter.active) {
+        if (state.view == VIEW_ALL) return at;
+
+        return list_rank(&state.todos, at, state.view == VIEW_DONE);
+    }
+
+    int low = 0;
+    int high = state.filter.count;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+
+        if (state.filter.rows[middle] < at) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+int view_empty() {
+    return view_count() == 0;
+}
+
+void view_settle() {
+    int count = view_count();
+
+    if ((!state.filter.active && state.view == VIEW_ALL) || count == 0) return;
+
+    int row = view_rank(state.cursor.y);
+
+    if (row < count && view_index(row) == state.cursor.y) return;
+
+    state.cursor.y = view_index(row < count ? row : count - 1);
+}
+
+int filter_match(int at) {
+    if (state.view != VIEW_ALL &&
+        list_done(&state.todos, at) != (state.view == VIEW_DONE)) return 0;
+
+    todo text = list_text(&state.todos, at);
+
+    return trigram_match(&text, state.filter.query, state.filter.length);
+}
+
+void filter_add(int at) {
+    struct filter_state *filter = &state.filter;
+    int row = view_rank(at);
+
+    if (row < filter->count && filter->rows[row] == at) return;
+
+    if (filter->count == filter->capacity) {
+        int capacity = filter->capacity ? filter->capacity * 2 : 64;
+        int *rows = realloc(filter->rows, sizeof(int) * capacity);
+
+        if (rows == NULL) return;
+
+        filter->rows = rows;
+        filter->capacity = capacity;
+    }
+
+    memmove(&filter->rows[row + 1], &filter->rows[row],
+        sizeof(int) * (filter->count - row));
+    filter->rows[row] = at;
+    filter->count++;
+}
+
+void filter_insert(int at) {
+    if (!state.filter.active) return;
+
+    struct filter_state *filter = &state.filter;
+
+    for (int i = view_rank(at); i < filter->count; i++) filter->rows[i]++;
+
+    if (filter_match(at)) filter_add(at);
+}
+
+int filter_erase(int at) {
+    struct filter_state *filter = &state.filter;
+    int row = view_rank(at);
+
+    if (row < filter->count && filter->rows[row] == at) {
+        filter->count--;
+        memmove(&filter->rows[row], &filter->rows[row + 1],
+            sizeof(int) * (filter->count - row));
+    }
+
+    return row;
+}
+
+void filter_remove(int at) {
+    if (!state.filter.active) return;
+
+    struct filter_state *filter = &state.filter;
+
+    for (int i = filter_erase(at); i < filter->count; i++) filter->rows[i]--;
+}
+
+void move_cursor(int key) {
+    switch (key) {
+        case ARROW_LEFT:
+            if (state.cursor.x > TODO_OFFSET &&
+                state.work_mode == WM_INSERT)
+                state.cursor.x--;
+            break;
+        case ARROW_RIGHT:
+            if (state.work_mode == WM_INSERT &&
+                state.cursor.x < state.editor.size + TODO_OFFSET)
+                state.cursor.x++;
+            break;
+        case SHIFT_TAB:
+        case ARROW_UP:
+            if (state.work_mode == WM_NORMAL) {
+                int row = view_rank(state.cursor.y);
+                if (row > 0) state.cursor.y = view_index(row - 1);
+            }
+            break;
+        case TAB_KEY:
+        case ARROW_DOWN:
+            if (state.work_mode == WM_NORMAL) {
+                int row = view_rank(state.cursor.y);
+                if (row < view_count() - 1) state.cursor.y = view_index(row + 1);
+            }
+            break;
+    }
+}
+
+void begin_insert_mode() {
+    state.work_mode = WM_INSERT;
+}
+
+void end_insert_mode() {
+    state.work_mode = WM_NORMAL;
+}
+
+void del_char() {
+    if (state.cursor.y == state.stats.count) return;
+
+    if (state.cursor.x > TODO_OFFSET) {
+        todo_del_char(&state.editor, state.cursor.x - TODO_OFFSET - 1);
+        row_cache_invalidate(&state.rows, state.cursor.y);
+        state.cursor.x--;
+    }
+}
+
+void insert_char(int c) {
+    todo_insert_char(&state.editor, state.cursor.x - TODO_OFFSET, c);
+    row_cache_invalidate(&state.rows, state.cursor.y);
+    state.cursor.x++;
+}
+
+void load_editor(int at) {
+    todo text = list_text(&state.todos, at);
+
+    state.editor.size = 0;
+    state.editor.gap = 0;
+    todo_insert_text(&state.editor, 0, text.string, text.size);
+}
+
+todo get_todo(int at) {
+    if (state.work_mode == WM_INSERT && at == state.cursor.y) return state.editor;
+
+    return list_text(&state.todos, at);
+}
+
+void push_todo(int at, const char *string, size_t length, int done) {
+    if (at < 0 || at > state.stats.count) return;
+
+    if (list_insert(&state.todos, at, string, length, done) == -1) return;
+
+    trigram_insert(&state.trigram, &state.todos, at);
+    filter_insert(at);
+    row_cache_clear(&state.rows);
+    state.stats.count++;
+
+    if (done) {
+        state.stats.done++;
+    } else {
+        state.stats.todo++;
+    }
+}
+
+void push_todo_text(int at, int done, const char *string, int length) {
+    push_todo(at, string, length, done);
+}
+
+void toggle_todo(int at) {
+    if (at < 0 || at >= state.stats.count) return;
+
+    int done = !list_done(&state.todos, at);
+
+    list_set_done(&state.todos, at, done);
+    row_cache_invalidate(&state.rows, at);
+
+    if (state.filter.active && state.view != VIEW_ALL) filter_erase(at);
+
+    if (done) {
+        state.stats.done++;
+        state.stats.todo--;
+    } else {
+        state.stats.done--;
+        state.stats.todo++;
+    }
+}
+
+void create_todo() {
+    if (state.view == VIEW_DONE && !state.filter.active) state.view = VIEW_ALL;
+
+    int at = state.insertion_mode == IM_AFTER ?
+        state.cursor.y + 1 : state.cursor.y;
+
+    if (at > state.stats.count) {
+        at = state.stats.count;
+    }
+
+    push_todo(at, "", 0, 0);
+    if (state.filter.active) filter_add(at);
+    load_editor(at);
+    state.insertion_new = 1;
+
+    if (state.insertion_mode == IM_AFTER) {
+        if (state.stats.count > state.cursor.y + 1) {
+            state.cursor.y++;
+        }
+    }
+
+    state.cursor.x = TODO_OFFSET;
+}
+
+void remove_todo(int at) {
+    if (at < 0 || at >= state.stats.count) return;
+
+    int done = list_done(&state.todos, at);
+
+    trigram_remove(&state.trigram, list_id(&state.todos, at));
+    list_remove(&state.todos, at);
+    filter_remove(at);
+    row_cache_clear(&state.rows);
+
+    state.stats.count--;
+
+    if (done) {
+        state.stats.done--;
+    } else {
+        state.stats.todo--;
+    }
+}
+
+void set_todo_text(int at, const char *string, int length) {
+    if (at < 0 || at >= state.stats.count) return;
+
+    if (list_set_text(&state.todos, at, string, length) == -1) return;
+
+    todo text = list_text(&state.todos, at);
+
+    trigram_update(&state.trigram, list_id(&state.todos, at), &text);
+    row_cache_invalidate(&state.rows, at);
+}
+
+char *remote_copy(const char *string, int length) {
+    char *copy = malloc(length + 1);
+
+    if (copy == NULL) die("malloc");
+
+    if (length) memcpy(copy, string, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+void remote_queue(const struct protocol_message *message, const char *payload) {
+    struct remote_state *remote = &state.remote;
+
+    if (remote->op_count == remote->op_capacity) {
+        int capacity = remote->op_capacity ? remote->op_capacity * 2 : 16;
+        struct remote_op *ops = realloc(remote->ops, sizeof(struct remote_op) * capacity);
+
+        if (ops == NULL) die("realloc");
+
+        remote->ops = ops;
+        remote->op_capacity = capacity;
+    }
+
+    struct remote_op *op = &remote->ops[remote->op_count++];
+    int anchor = message->type == PROTOCOL_INSERT ?
+        (int) message->at - 1 : (int) message->at;
+
+    op->message = *message;
+    op->payload = remote_copy(payload, message->length);
+    op->anchor = NULL;
+    op->anchor_length = -1;
+
+    if (anchor >= 0 && anchor < state.stats.count) {
+        todo text = list_text(&state.todos, anchor);
+
+        op->anchor = remote_copy(text.string, text.size);
+        op->anchor_length = text.size;
+    }
+}
+
+void remote_ack() {
+    struct remote_state *remote = &state.remote;
+
+    if (remote->op_count == 0) return;
+
+    free(remote->ops[0].payload);
+    free(remote->ops[0].anchor);
+    remote->op_count--;
+    memmove(&remote->ops[0], &remote->ops[1], sizeof(struct remote_op) * remote->op_count);
+}
+
+int remote_send(int type, int at, int done, const char *string, int length) {
+    struct protocol_message message = {
+        type, state.remote.version++, at, 0, done, length
+    };
+
+    remote_queue(&message, string);
+    protocol_send(&state.remote.stream, &message, string);
+    if (protocol_write(&state.remote.stream) == -1) die("todo server");
+
+    return 0;
+}
+
+int record_toggle(int at) {
+    if (state.remote.active) {
+        return remote_send(PROTOCOL_TOGGLE, at, list_done(&state.todos, at), NULL, 0);
+    }
+
+    return journal_toggle(&state.journal, at);
+}
+
+int record_insert(int at, int done, const char *string, int length) {
+    if (state.remote.active) {
+        state.remote.count++;
+        return remote_send(PROTOCOL_INSERT, at, done, string, length);
+    }
+
+    return journal_insert(&state.journal, at, done, string, length);
+}
+
+int record_delete(int at) {
+    if (state.remote.active) {
+        state.remote.count--;
+        return remote_send(PROTOCOL_DELETE, at, 0, NULL, 0);
+    }
+
+    return journal_delete(&state.journal, at);
+}
+
+int record_edit(int at, const char *string, int length) {
+    if (state.remote.active) return remote_send(PROTOCOL_EDIT, at, 0, string, length);
+
+    return journal_edit(&state.journal, at, string, length);
+}
+
+void edit_todo() {
+    state.insertion_mode = IM_CURRENT;
+    state.insertion_new = 0;
+    load_editor(state.cursor.y);
+    state.cursor.x = state.editor.size + TODO_OFFSET;
+}
+
+void commit_todo() {
+    int at = state.cursor.y;
+    todo *current = &state.editor;
+
+    todo_flatten(current);
+
+    if (state.remote.active) {
+        for (int i = 0; i < current->size; i++) {
+            if (current->string[i] == '\n') current->string[i] = ' ';
+        }
+    }
+
+    if (current->size == 0) {
+        int written = state.insertion_new ? 0 : record_delete(at);
+
+        remove_todo(at);
+        when_journal(written);
+        state.insertion_new = 0;
+        return;
+    }
+
+    int written = state.insertion_new ? 0 :
+        record_edit(at, current->string, current->size);
+
+    set_todo_text(at, current->string, current->size);
+
+    if (state.insertion_new) {
+        written = record_insert(at, list_done(&state.todos, at),
+            current->string, current->size);
+    }
+
+    when_journal(written);
+    state.insertion_new = 0;
+}
+
+const char *paste_line(const char *text, const char *end, int *length) {
+    const char *eol = text;
+
+    while (eol < end && *eol != '\r' && *eol != '\n') eol++;
+
+    *length = eol - text;
+
+    if (eol < end && *eol++ == '\r' && eol < end && *eol == '\n') eol++;
+
+    return eol;
+}
+
+void paste_todos(const char *text, int length) {
+    const char *end = text + length;
+    const char *line = text;
+
+    journal_begin(&state.journal);
+
+    while (line < end) {
+        int line_length;
+        const char *next = paste_line(line, end, &line_length);
+
+        if (line_length > 0) {
+            const char *string = line;
+            int done = 0;
+
+            if (is_todo_line(line, line_length)) {
+                done = line[0] == '-' ? 1 : 0;
+                string += 2;
+                line_length -= 2;
+            }
+
+            int at = state.stats.count == 0 ? 0 : state.cursor.y + 1;
+
+            push_todo(at, string, line_length, done);
+            record_insert(at, done, string, line_length);
+            state.cursor.y = at;
+        }
+
+        line = next;
+    }
+
+    when_journal(journal_commit(&state.journal));
+}
+
+void paste_text(const char *text, int length) {
+    const char *end = text + length;
+    const char *line = text;
+
+    journal_begin(&state.journal);
+
+    while (1) {
+        int line_length;
+        const char *next = paste_line(line, end, &line_length);
+
+        if (line != text && state.editor.size != 0) {
+            commit_todo();
+            state.insertion_mode = IM_AFTER;
+            create_todo();
+        }
+
+        todo_insert_text(&state.editor, state.cursor.x - TODO_OFFSET, line, line_length);
+        row_cache_invalidate(&state.rows, state.cursor.y);
+        state.cursor.x += line_length;
+
+        if (next == line + line_length) break;
+
+        line = next;
+    }
+
+    when_journal(journal_commit(&state.journal));
+}
+
+int match_todo(int at) {
+    todo current = list_text(&state.todos, at);
+
+    return search_find(current.string, current.size,
+        state.search.query, state.search.length,
+        !search_has_upper(state.search.query, state.search.length)) != -1;
+}
+
+int find_todo(int from, int direction, int *matches) {
+    int count = view_count();
+    int found = -1;
+    int i;
+
+    if (matches) *matches = 0;
+    if (state.search.length == 0 || count == 0) return -1;
+
+    for (i = 0; i < count; i++) {
+        int row = (from + i * direction) % count;
+        if (row < 0) row += count;
+
+        int at = view_index(row);
+
+        if (match_todo(at)) {
+            if (found == -1) found = at;
+            if (matches == NULL) break;
+            (*matches)++;
+        }
+    }
+
+    return found;
+}
+
+void update_search() {
+    int found = find_todo(view_rank(state.search.origin), 1, &state.search.matches);
+
+    state.cursor.y = found == -1 ? state.search.origin : found;
+}
+
+void begin_search_mode() {
+    state.work_mode = WM_SEARCH;
+    state.search.length = 0;
+    state.search.matches = 0;
+    state.search.origin = state.cursor.y;
+}
+
+void search_next(int direction) {
+    if (view_empty()) return;
+
+    int found = find_todo(view_rank(state.cursor.y) + direction, direction, NULL);
+
+    if (found == -1) {
+        set_status_message("Pattern not found");
+    } else {
+        state.cursor.y = found;
+    }
+}
+
+void search_keys(int c) {
+    switch (c) {
+        case '\x1b':
+            state.cursor.y = state.search.origin;
+            state.work_mode = WM_NORMAL;
+            break;
+
+        case '\r':
+            state.work_mode = WM_NORMAL;
+            break;
+
+        case BACKSPACE:
+        case ctrl_key('h'):
+            if (state.search.length == 0) {
+                state.cursor.y = state.search.origin;
+                state.work_mode = WM_NORMAL;
+            } else {
+                state.search.length--;
+                update_search();
+            }
+            break;
+
+        default:
+            if (c < 256 && isprint(c) &&
+                state.search.length < (int) sizeof(state.search.query)) {
+                state.search.query[state.search.length++] = c;
+                update_search();
+            }
+    }
+}
+
+void update_filter(int narrow) {
+    struct filter_state *filter = &state.filter;
+
+    narrow = narrow && filter->active ? filter->count : -1;
+    filter->active = filter->length != 0;
+
+    if (filter->active) {
+        filter->count = trigram_filter(&state.trigram, &state.todos,
+            filter->query, filter->length, &filter->rows, &filter->capacity,
+            narrow);
+    }
+
+    if (filter->active && state.view != VIEW_ALL) {
+        int count = 0;
+
+        for (int i = 0; i < filter->count; i++) {
+            if (list_done(&state.todos, filter->rows[i]) == (state.view == VIEW_DONE))
+                filter->rows[count++] = filter->rows[i];
+        }
+
+        filter->count = count;
+    }
+
+    row_cache_clear(&state.rows);
+    view_settle();
+}
+
+void flush_filter() {
+    if (state.filter.pending == -1) return;
+
+    update_filter(state.filter.pending);
+    state.filter.pending = -1;
+}
+
+void begin_filter_mode() {
+    state.work_mode = WM_FILTER;
+}
+
+void clear_filter() {
+    state.filter.length = 0;
+    state.filter.pending = 0;
+    flush_filter();
+}
+
+void filter_keys(int c) {
+    switch (c) {
+        case '\x1b':
+            clear_filter();
+            state.work_mode = WM_NORMAL;
+            break;
+
+        case '\r':
+            state.work_mode = WM_NORMAL;
+            break;
+
+        case BACKSPACE:
+        case ctrl_key('h'):
+            if (state.filter.length == 0) {
+                state.work_mode = WM_NORMAL;
+            } else {
+                state.filter.length--;
+                state.filter.pending = 0;
+            }
+            break;
+
+        default:
+            if (c < 256 && isprint(c) &&
+                state.filter.length < (int) sizeof(state.filter.query)) {
+                state.filter.query[state.filter.length++] = c;
+                if (state.filter.pending == -1) state.filter.pending = 1;
+            }
+    }
+}
+
+void cycle_view() {
+    static const char *names[] = { "all", "open", "done" };
+
+    state.view = (state.view + 1) % 3;
+
+    if (state.filter.active) {
+        state.filter.pending = 0;
+        flush_filter();
+    }
+
+    row_cache_clear(&state.rows);
+    view_settle();
+    set_status_message("Showing %s todos", names[state.view]);
+}
+
+void show_memory() {
+    struct arena_stats stats;
+
+    arena_stats(&state.todos.arena, &stats);
+    set_status_message("text %zu KiB live, %zu/%zu KiB arena, %d%% fragmented",
+        stats.live / 1024, stats.used / 1024, stats.capacity / 1024,
+        stats.fragmentation);
+}
+
+void when_loaded() {
+    if (!state.remote.active) {
+        rebase();
+        stat(state.filename, &state.merge.seen);
+        if (!state.batch) watch_open(&state.watch, state.filename);
+        arena_bulk(&state.todos.arena, 1);
+
+        struct journal_handler handler = {
+            toggle_todo, push_todo_text, remove_todo, set_todo_text
+        };
+
+        if (journal_open(&state.journal, state.filename, &handler) == -1) {
+            journal_close(&state.journal);
+        }
+
+        arena_bulk(&state.todos.arena, 0);
+
+        if (writer_start(&state.writer, &state.journal, state.filename,
+            state.wakeup[1], state.sync) == -1) {
+            die("writer_start");
+        }
+    }
+
+    if (state.cursor.y >= state.stats.count) {
+        state.cursor.y = state.stats.count ? state.stats.count - 1 : 0;
+    }
+}
+
+void remote_apply(struct protocol_message *message, const char *payload) {
+    int fetched = state.stats.count;
+    int loaded = !state.load.active;
+    int at = message->at;
+
+    state.remote.version = message->version;
+
+    switch (message->type) {
+        case PROTOCOL_INSERT:
+            state.remote.count++;
+            if (at > fetched || (at == fetched && !loaded)) break;
+
+            push_todo(at, payload, message->length, message->done);
+            if (at <= state.cursor.y && state.stats.count > 1) state.cursor.y++;
+            break;
+        case PROTOCOL_DELETE:
+            state.remote.count--;
+            if (at >= fetched) break;
+
+            remove_todo(at);
+            if (at < state.cursor.y) state.cursor.y--;
+            break;
+        case PROTOCOL_TOGGLE:
+            if (at < fetched) toggle_todo(at);
+            break;
+        case PROTOCOL_EDIT:
+            if (at < fetched) set_todo_text(at, payload, message->length);
+            break;
+    }
+}
+
+void remote_handle(struct protocol_message *message, const char *payload) {
+    if (message->type == PROTOCOL_STATE) {
+        state.remote.version = message->version;
+        state.remote.count = message->count;
+        state.remote.stale = 0;
+        return;
+    }
+
+    if (state.remote.stale) return;
+
+    switch (message->type) {
+        case PROTOCOL_STALE:
+            state.remote.stale = 1;
+            state.remote.resync = 1;
+            break;
+        case PROTOCOL_ERROR:
+            set_status_message("Server: %.*s", (int) message->length, payload);
+
+            if (state.remote.op_count) {
+                remote_ack();
+                state.remote.stale = 1;
+                state.remote.resync = 1;
+            }
+            break;
+        case PROTOCOL_ACK:
+            remote_ack();
+            break;
+        case PROTOCOL_INSERT:
+        case PROTOCOL_DELETE:
+        case PROTOCOL_TOGGLE:
+        case PROTOCOL_EDIT:
+            remote_apply(message, payload);
+            break;
+    }
+}
+
+int remote_wait(int type, struct protocol_message *message, const char **payload) {
+    while (1) {
+        int found = protocol_next(&state.remote.stream, message, payload);
+
+        if (found == -1) die("todo server");
+
+        if (found) {
+            remote_handle(message, *payload);
+
+            if (message->type == PROTOCOL_ERROR) return -1;
+            if (message->type == (uint32_t) type) return 0;
+        } else if (protocol_read(&state.remote.stream) == -1) {
+            die("todo server");
+        }
+    }
+}
+
+void remote_receive() {
+    struct protocol_message message;
+    const char *payload;
+    int found;
+
+    if (protocol_read(&state.remote.stream) == -1) die("todo server");
+
+    while ((found = protocol_next(&state.remote.stream, &message, &payload)) == 1) {
+        remote_handle(&message, payload);
+    }
+
+    if (found == -1) die("todo server");
+
+    if (state.cursor.y >= state.stats.count) {
+        state.cursor.y = state.stats.count ? state.stats.count - 1 : 0;
+    }
+
+    view_settle();
+}
+
+void remote_fetch(int count) {
+    struct protocol_message message = {
+        PROTOCOL_RANGE, state.remote.version, state.stats.count, count, 0, 0
+    };
+    const char *payload;
+
+    protocol_send(&state.remote.stream, &message, NULL);
+    if (protocol_write(&state.remote.stream) == -1) die("todo server");
+
+    if (remote_wait(PROTOCOL_ITEMS, &message, &payload) == -1 ||
+        state.remote.stale || message.version != state.remote.version) {
+        state.remote.stale = 1;
+        state.remote.resync = 1;
+        state.load.active = 0;
+        return;
+    }
+
+    const char *end = payload + message.length;
+    const char *string;
+    int length, done;
+    int fetched = 0;
+
+    while ((payload = protocol_next_item(payload, end, &string, &length, &done))) {
+        push_todo(state.stats.count, string, length, done);
+        fetched++;
+    }
+
+    state.remote.count = message.count;
+
+    if (fetched == 0 || state.stats.count >= state.remote.count) {
+        state.load.active = 0;
+        when_loaded();
+    }
+}
+
+int remote_reopen() {
+    struct protocol_message message = {
+        PROTOCOL_OPEN, 0, 0, 0, 0, strlen(state.remote.path)
+    };
+    const char *payload;
+
+    state.remote.stale = 1;
+    state.remote.resync = 0;
+    protocol_send(&state.remote.stream, &message, state.remote.path);
+    if (protocol_write(&state.remote.stream) == -1) die("todo server");
+
+    if (remote_wait(PROTOCOL_STATE, &message, &payload) == -1) return -1;
+
+    state.load.active = 1;
+
+    if (state.remote.count == 0) {
+        state.load.active = 0;
+        when_loaded();
+    }
+
+    return 0;
+}
+
+int remote_open(const char *filename) {
+    char *path = protocol_path(filename);
+    int fd = path ? protocol_connect(path) : -1;
+
+    free(path);
+
+    if (fd == -1) return -1;
+
+    struct protocol_message message = { PROTOCOL_SUBSCRIBE, 0, 0, 0, 0, 0 };
+
+    state.remote.stream.fd = fd;
+    state.remote.path = realpath(filename, NULL);
+    state.remote.active = 1;
+
+    if (state.remote.path == NULL) die("realpath");
+
+    protocol_send(&state.remote.stream, &message, NULL);
+
+    if (remote_reopen() == -1) {
+        protocol_close(&state.remote.stream);
+        free(state.remote.path);
+        state.remote.path = NULL;
+        state.remote.active = 0;
+        state.load.active = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+void load_chunk() {
+    if (state.remote.active) {
+        remote_fetch(TODO_FETCH_ITEMS);
+        return;
+    }
+
+    struct loader *loader = &state.load.loader;
+    struct loader_chunk *chunk = &loader->chunks[state.load.next];
+    struct trace_span span;
+
+    trace_begin(&state.trace, &span);
+
+    if (loader_wait(loader, state.load.next) == -1) die("loader_parse_chunk");
+    if (loader_append(chunk, &state.todos) == -1) die("list_append");
+
+    for (int i = state.stats.count; i < state.stats.count + chunk->count; i++) {
+        trigram_insert(&state.trigram, &state.todos, i);
+    }
+
+    state.stats.count += chunk->count;
+    state.stats.done += chunk->done_count;
+    state.stats.todo += chunk->count - chunk->done_count;
+
+    trace_end(&state.trace, &span, "load_chunk");
+
+    if (++state.load.next == loader->chunk_count) {
+        loader_finish(loader);
+        state.load.active = 0;
+        when_loaded();
+    }
+}
+
+int load_pending() {
+    return state.load.active && !state.remote.active &&
+        loader_ready(&state.load.loader, state.load.next);
+}
+
+void load_ready() {
+    if (load_pending()) load_chunk();
+}
+
+void load_rows(int rows) {
+    while (state.load.active && view_count() < rows) load_chunk();
+}
+
+void load_all() {
+    while (state.load.active) {
+        if (state.remote.active) {
+            remote_fetch(LOADER_CHUNK_ITEMS);
+        } else {
+            load_chunk();
+        }
+    }
+}
+
+int load_progress() {
+    struct loader *loader = &state.load.loader;
+
+    if (state.remote.active) {
+        return state.remote.count ?
+            (long long) state.stats.count * 100 / state.remote.count : 100;
+    }
+
+    return (loader->chunks[state.load.next].start - loader->base) * 100 /
+        loader->length;
+}
+
+void load_start() {
+    state.load.next = 0;
+    loader_start(&state.load.loader, state.wakeup[1]);
+
+    if (state.load.loader.chunk_count == 0) {
+        loader_finish(&state.load.loader);
+        when_loaded();
+        return;
+    }
+
+    state.load.active = 1;
+    load_rows(state.screen_rows);
+}
+
+int remote_find(const struct remote_op *op, int near) {
+    int count = state.stats.count;
+
+    if (op->anchor_length < 0) return -1;
+
+    for (int distance = 0; distance <= count; distance++) {
+        for (int side = 0; side < 2; side++) {
+            int at = side ? near + distance : near - distance;
+
+            if (at < 0 || at >= count || (side && distance == 0)) continue;
+
+            todo text = list_text(&state.todos, at);
+
+            if (text.size == op->anchor_length &&
+                memcmp(text.string, op->anchor, text.size) == 0) return at;
+        }
+    }
+
+    return -1;
+}
+
+int remote_retry(const struct remote_op *op) {
+    const struct protocol_message *message = &op->message;
+    int length = message->length;
+    int at;
+
+    switch (message->type) {
+        case PROTOCOL_INSERT:
+            at = remote_find(op, message->at - 1) + 1;
+
+            if (at == 0 && op->anchor_length >= 0) {
+                at = (int) message->at < state.stats.count ?
+                    (int) message->at : state.stats.count;
+            }
+
+            push_todo(at, op->payload, length, message->done);
+            record_insert(at, message->done, op->payload, length);
+            return 0;
+        case PROTOCOL_DELETE:
+            if ((at = remote_find(op, message->at)) == -1) return -1;
+
+            record_delete(at);
+            remove_todo(at);
+            return 0;
+        case PROTOCOL_TOGGLE:
+            if ((at = remote_find(op, message->at)) == -1) return -1;
+
+            if (list_done(&state.todos, at) != (int) message->done) {
+                toggle_todo(at);
+                record_toggle(at);
+            }
+            return 0;
+        case PROTOCOL_EDIT:
+            if ((at = remote_find(op, message->at)) == -1) return -1;
+
+            record_edit(at, op->payload, length);
+            set_todo_text(at, op->payload, length);
+            return 0;
+    }
+
+    return -1;
+}
+
+int remote_replay() {
+    struct remote_op *ops = state.remote.ops;
+    int count = state.remote.op_count;
+    int failed = 0;
+
+    state.remote.ops = NULL;
+    state.remote.op_count = 0;
+    state.remote.op_capacity = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (remote_retry(&ops[i]) == -1) failed++;
+
+        free(ops[i].payload);
+        free(ops[i].anchor);
+    }
+
+    free(ops);
+
+    return failed;
+}
+
+void remote_resync() {
+    while (state.stats.count) remove_todo(state.stats.count - 1);
+
+    if (state.trigram.buckets) trigram_init(&state.trigram);
+
+    if (remote_reopen() == -1) die("todo server");
+
+    if (state.remote.op_count == 0) {
+        load_rows(state.row_offset + state.screen_rows);
+        set_status_message("List changed by another client, reloaded");
+        return;
+    }
+
+    load_all();
+
+    if (state.remote.resync) return;
+
+    int failed = remote_replay();
+
+    if (failed) {
+        set_status_message("List changed by another client, %d of your changes "
+            "could not be applied", failed);
+    } else {
+        set_status_message("List changed by another client, your changes were reapplied");
+    }
+
+    if (state.cursor.y >= state.stats.count) {
+        state.cursor.y = state.stats.count ? state.stats.count - 1 : 0;
+    }
+
+    view_settle();
+}
+
+void load_todos(int file, size_t length) {
+    struct loader *loader = &state.load.loader;
+
+    if (loader_open(loader, file, length) == -1) die("loader_open");
+
+    state.map = loader->buffer;
+    state.map_length = length;
+
+    if (list_map(&state.todos, loader->buffer, length) == -1) die("list_map");
+
+    load_start();
+}
+
+void load_snapshot(struct snapshot *snapshot) {
+    if (loader_attach(&state.load.loader, snapshot->map, snapshot->length,
+        snapshot->offsets, snapshot->lengths, snapshot->done,
+        snapshot->count) == -1) die("loader_attach");
+
+    load_start();
+}
+
+void merge_hunk(struct diff_hunk *hunk, const char *map,
+    const uint32_t *offsets, const uint32_t *lengths, const unsigned char *done) {
+    int at = hunk->a_start;
+    int old_count = hunk->a_end - hunk->a_start;
+    int new_count = hunk->b_end - hunk->b_start;
+    int common = old_count < new_count ? old_count : new_count;
+
+    for (int i = 0; i < common; i++) {
+        int line = hunk->b_start + i;
+        todo text = list_text(&state.todos, at + i);
+
+        if (text.size != (int) lengths[line] ||
+            memcmp(text.string, &map[offsets[line]], text.size) != 0) {
+            set_todo_text(at + i, &map[offsets[line]], lengths[line]);
+        }
+
+        if (list_done(&state.todos, at + i) != done[line]) toggle_todo(at + i);
+    }
+
+    for (int i = common; i < old_count; i++) remove_todo(at + common);
+
+    for (int i = common; i < new_count; i++) {
+        int line = hunk->b_start + i;
+        push_todo(at + i, &map[offsets[line]], lengths[line], done[line]);
+    }
+}
+
+int merge_position(int at, const struct diff_hunk *hunks, int count) {
+    int shift = 0;
+
+    for (int i = 0; i < count; i++) {
+        const struct diff_hunk *hunk = &hunks[i];
+        int length = hunk->b_end - hunk->b_start;
+
+        if (at >= hunk->a_end && hunk->a_end > hunk->a_start) {
+            shift += length - (hunk->a_end - hunk->a_start);
+        } else if (at >= hunk->a_start && hunk->a_end > hunk->a_start) {
+            int offset = at - hunk->a_start;
+            return hunk->a_start + shift + (offset < length ? offset : length - 1);
+        } else if (at >= hunk->a_start) {
+            shift += length;
+        } else {
+            break;
+        }
+    }
+
+    return at + shift;
+}
+
+int merge_lines(struct diff_hunk *remote, int remote_count,
+    const struct diff_hunk *local, int local_count) {
+    int conflicts = 0;
+    int shift = 0;
+    int consumed = 0;
+    int j = 0;
+
+    for (int i = 0; i < remote_count; i++) {
+        struct diff_hunk *hunk = &remote[i];
+        int conflict = hunk->a_start < consumed;
+
+        while (j < local_count && local[j].a_end <= hunk->a_start) {
+            shift += (local[j].b_end - local[j].b_start) -
+                (local[j].a_end - local[j].a_start);
+            j++;
+        }
+
+        while (j < local_count && local[j].a_start < hunk->a_end) {
+            shift += (local[j].b_end - local[j].b_start) -
+                (local[j].a_end - local[j].a_start);
+            consumed = local[j].a_end;
+            conflict = 1;
+            j++;
+        }
+
+        if (conflict) {
+            int end = hunk->a_end > consumed ? hunk->a_end : consumed;
+
+            hunk->a_start = end + shift;
+            hunk->a_end = end + shift;
+            conflicts++;
+        } else {
+            hunk->a_start += shift;
+            hunk->a_end += shift;
+        }
+    }
+
+    return conflicts;
+}
+
+int when_changed() {
+    struct stat st;
+
+    state.merge.pending = 0;
+    load_all();
+    merge_confirm();
+
+    int file = open(state.filename, O_RDONLY);
+    if (file == -1) return 0;
+
+    if (fstat(file, &st) == -1 || writer_wrote(&state.writer, &st) ||
+        (st.st_ino == state.merge.seen.st_ino &&
+            st.st_size == state.merge.seen.st_size &&
+            st.st_mtim.tv_sec == state.merge.seen.st_mtim.tv_sec &&
+            st.st_mtim.tv_nsec == state.merge.seen.st_mtim.tv_nsec)) {
+        close(file);
+        return 0;
+    }
+
+    struct loader loader;
+
+    if (loader_open(&loader, file, st.st_size) == -1) die("loader_open");
+
+    close(file);
+    loader_start(&loader, -1);
+
+    const char *map = loader.buffer;
+    int count = 0;
+    int failed = 0;
+
+    for (int i = 0; i < loader.chunk_count; i++) {
+        if (loader_wait(&loader, i) == -1) failed = 1;
+        count += loader.chunks[i].count;
+    }
+
+    if (failed) {
+        loader_finish(&loader);
+        free(loader.buffer);
+        state.merge.pending = 1;
+        return 0;
+    }
+
+    state.merge.seen = st;
+
+    uint32_t *offsets = malloc(sizeof(uint32_t) * (count + 1));
+    uint32_t *lengths = malloc(sizeof(uint32_t) * (count + 1));
+    unsigned char *done = malloc(count + 1);
+    uint64_t *hashes = malloc(sizeof(uint64_t) * (count + 1));
+
+    if (!offsets || !lengths || !done || !hashes) die("malloc");
+
+    for (int i = 0, line = 0; i < loader.chunk_count; i++) {
+        struct loader_chunk *chunk = &loader.chunks[i];
+
+        memcpy(&offsets[line], chunk->offsets, sizeof(uint32_t) * chunk->count);
+        memcpy(&lengths[line], chunk->lengths, sizeof(uint32_t) * chunk->count);
+        memcpy(&done[line], chunk->done, chunk->count);
+        line += chunk->count;
+    }
+
+    loader_finish(&loader);
+
+    for (int i = 0; i < count; i++) {
+        hashes[i] = diff_hash(&map[offsets[i]], lengths[i], done[i]);
+    }
+
+    uint64_t *current = hash_todos();
+    struct diff_hunk *remote = NULL;
+    struct diff_hunk *local = NULL;
+    int remote_count = 0;
+    int local_count = 0;
+    int remote_diff = -1;
+    int local_diff = -1;
+
+    if (current == NULL ||
+        (remote_diff = diff_lines(state.merge.base, state.merge.count, hashes,
+            count, &remote, &remote_count)) == -1 ||
+        (local_diff = diff_lines(state.merge.base, state.merge.count, current,
+            state.stats.count, &local, &local_count)) == -1) die("diff_lines");
+
+    int conflicts = merge_lines(remote, remote_count, local, local_count);
+
+    if (conflicts && (remote_diff == DIFF_COARSE || local_diff == DIFF_COARSE)) {
+        free(loader.buffer);
+        free(offsets);
+        free(lengths);
+        free(done);
+        free(hashes);
+        free(current);
+        free(remote);
+        free(local);
+        set_status_message("External changes not merged: too many differences");
+        return 0;
+    }
+    int row = view_rank(state.cursor.y) - state.row_offset;
+    int cursor = state.stats.count ?
+        merge_position(state.cursor.y, remote, remote_count) : 0;
+
+    for (int i = remote_count - 1; i >= 0; i--) {
+        merge_hunk(&remote[i], map, offsets, lengths, done);
+    }
+
+    free(state.merge.base);
+    state.merge.base = hashes;
+    state.merge.count = count;
+
+    free(loader.buffer);
+    free(offsets);
+    free(lengths);
+    free(done);
+    free(current);
+    free(remote);
+    free(local);
+
+    if (cursor >= state.stats.count) cursor = state.stats.count - 1;
+    state.cursor.y = cursor < 0 ? 0 : cursor;
+
+    if (state.filter.active) update_filter(0);
+    view_settle();
+
+    state.row_offset = view_empty() ? 0 : view_rank(state.cursor.y) - row;
+    if (state.row_offset < 0) state.row_offset = 0;
+
+    if (local_count || conflicts || state.merge.save_count) {
+        when_save();
+    } else {
+        writer_save(&state.writer, NULL, 0);
+    }
+
+    if (remote_count) {
+        set_status_message("Merged %d external changes, %d conflicts",
+            remote_count, conflicts);
+    }
+
+    return remote_count;
+}
+
+void compact_text() {
+    if (list_compact(&state.todos) == -1) {
+        set_status_message("Can't compact text: %s", strerror(errno));
+    }
+}
+
+void normal_keys(int c) {
+    switch (c) {
+        case '\r':
+            state.insertion_mode = IM_AFTER;
+            create_todo();
+            begin_insert_mode();
+            break;
+
+        case ALT_ENTER:
+            state.insertion_mode = IM_BEFORE;
+            create_todo();
+            begin_insert_mode();
+            break;
+
+        case ctrl_key('q'):
+            when_quit();
+            break;
+
+        case 'e':
+            if (view_empty()) break;
+            edit_todo();
+            begin_insert_mode();
+            break;
+
+        case PASTE_KEY:
+            paste_todos(state.input.paste.string, state.input.paste.length);
+            break;
+
+        case '/':
+            begin_search_mode();
+            break;
+
+        case 'n':
+            search_next(1);
+            break;
+
+        case 'N':
+            search_next(-1);
+            break;
+
+        case 'f':
+            begin_filter_mode();
+            break;
+
+        case 'v':
+            cycle_view();
+            break;
+
+        case 'm':
+            show_memory();
+            break;
+
+        case '\x1b':
+            if (state.filter.active) clear_filter();
+            break;
+
+        case ctrl_key('l'):
+            frame_invalidate(&state.frame);
+            break;
+
+        case 'p':
+            trace_toggle(&state.trace);
+            break;
+
+        case ' ':
+            if (view_empty()) break;
+            toggle_todo(state.cursor.y);
+            when_journal(record_toggle(state.cursor.y));
+            break;
+
+        case HOME_KEY:
+            state.cursor.y = view_empty() ? 0 : view_index(0);
+            break;
+        case END_KEY:
+            if (!view_empty()) state.cursor.y = view_index(view_count() - 1);
+            break;
+
+        case DEL_KEY:
+        case BACKSPACE:
+            if (view_empty()) break;
+            if (c == BACKSPACE) move_cursor(ARROW_UP);
+            if (state.cursor.y < state.stats.count) {
+                int written = record_delete(state.cursor.y);
+
+                remove_todo(state.cursor.y);
+                when_journal(written);
+            }
+            break;
+
+        case PAGE_DOWN:
+        case PAGE_UP:
+            {
+                int times = state.screen_rows / 2;
+                while (times--)
+                    move_cursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
+            }
+            break;
+
+        case ARROW_DOWN:
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+        case ARROW_UP:
+        case TAB_KEY:
+        case SHIFT_TAB:
+            move_cursor(c);
+            break;
+    }
+}
+
+void insert_keys(int c) {
+    switch (c) {
+        case '\x1b':
+        case '\r':
+            end_insert_mode();
+            {
+                int empty = state.editor.size == 0;
+
+                commit_todo();
+
+                if (empty && state.insertion_mode == IM_AFTER) {
+                    move_cursor(ARROW_UP);
+                }
+            }
+            break;
+
+        case TAB_KEY:
+            if (state.editor.size != 0) {
+                commit_todo();
+                state.insertion_mode = IM_AFTER;
+                create_todo();
+                begin_insert_mode();
+            }
+            break;
+
+        case SHIFT_TAB:
+            if (state.editor.size != 0) {
+                commit_todo();
+                state.insertion_mode = IM_BEFORE;
+                create_todo();
+                begin_insert_mode();
+            }
+            break;
+
+        case ctrl_key('l'):
+            frame_invalidate(&state.frame);
+            break;
+
+        case PASTE_KEY:
+            paste_text(state.input.paste.string, state.input.paste.length);
+            break;
+
+        case PAGE_DOWN:
+        case PAGE_UP:
+        case ALT_ENTER:
+            break;
+
+        case HOME_KEY:
+            state.cursor.x = TODO_OFFSET;
+            break;
+        case END_KEY:
+            if (state.cursor.y < state.stats.count) {
+                state.cursor.x = state.editor.size + TODO_OFFSET;
+            }
+            break;
+
+        case BACKSPACE:
+        case ctrl_key('h'):
+        case DEL_KEY:
+            if (c == DEL_KEY) move_cursor(ARROW_RIGHT);
+            del_char();
+            break;
+
+        case ARROW_DOWN:
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+        case ARROW_UP:
+            move_cursor(c);
+            break;
+        default:
+            insert_char(c);
+    }
+}
+
+void process_key(int c) {
+    if (state.work_mode == WM_NORMAL) {
+        normal_keys(c);
+    } else if (state.work_mode == WM_SEARCH) {
+        search_keys(c);
+    } else if (state.work_mode == WM_FILTER) {
+        filter_keys(c);
+    } else {
+        insert_keys(c);
+    }
+}
+
+int browse_key(int c) {
+    if (state.work_mode != WM_NORMAL) return 0;
+
+    switch (c) {
+        case ARROW_UP:
+        case ARROW_DOWN:
+        case TAB_KEY:
+        case SHIFT_TAB:
+        case PAGE_UP:
+        case PAGE_DOWN:
+        case HOME_KEY:
+        case ctrl_key('l'):
+        case ctrl_key('q'):
+        case 'v':
+        case 'm':
+        case 'p':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void process_keys(int final) {
+    struct trace_span span;
+    int c;
+
+    trace_begin(&state.trace, &span);
+
+    while (input_next(&state.input, &c, final)) {
+        if (state.load.active && !browse_key(c)) load_all();
+        load_rows(view_rank(state.cursor.y) + state.screen_rows + 1);
+        if (state.work_mode != WM_FILTER) flush_filter();
+        process_key(c);
+        view_settle();
+    }
+
+    flush_filter();
+    view_settle();
+
+    trace_end(&state.trace, &span, "process_keys");
+}
+
+void scrolling() {
+    int row = view_rank(state.cursor.y);
+
+    if (row < state.row_offset) {
+        state.row_offset = row;
+    }
+
+    if (row >= state.row_offset + state.screen_rows) {
+        state.row_offset = row - state.screen_rows + 1;
+    }
+}
+
+int todo_style(int done, char c) {
+    return done && isprint((unsigned char) c) ?
+        STYLE_STRIKE | STYLE_MAGENTA : STYLE_PLAIN;
+}
+
+void render_todo(struct buffer *content, struct todo src, int done, int index) {
+    char pointer = index != state.cursor.y ? ' ' :
+                    state.work_mode == WM_INSERT ? '*' : '>';
+
+    struct buffer *cached = row_cache_lookup(&state.rows, index, pointer);
+
+    if (cached) {
+        buffer_append(content, cached->string, cached->length);
+        return;
+    }
+
+    int start = content->length;
+
+    buffer_append(content, "  ", 2);
+    buffer_append(content, &pointer, 1);
+    buffer_append(content, " ", 1);
+    buffer_append(content, done ? " " : "-", 1);
+    buffer_append(content, " ", 1);
+
+    int length = src.size;
+
+    if (length + TODO_OFFSET > state.screen_cols)
+        length = state.screen_cols - TODO_OFFSET;
+
+    struct style style;
+    style_begin(&style, content);
+
+    int at = 0;
+    while (at < length) {
+        int span_length;
+        const char *span = todo_span(&src, at, &span_length);
+
+        if (span_length > length - at) span_length = length - at;
+
+        int run = 0;
+        while (run < span_length) {
+            int flags = todo_style(done, span[run]);
+            int end = run + 1;
+
+            while (end < span_length && todo_style(done, span[end]) == flags)
+                end++;
+
+            style_append(&style, flags, &span[run], end - run);
+            run = end;
+        }
+
+        at += span_length;
+    }
+
+    style_end(&style);
+
+    struct buffer rendered = {
+        &content->string[start], content->length - start, content->length - start
+    };
+    row_cache_store(&state.rows, index, pointer, &rendered);
+}
+
+void render(struct buffer *content) {
+    struct buffer *row = &state.line;
+    struct trace_span span;
+
+    trace_begin(&state.trace, &span);
+
+    for (int i = 0; i < state.screen_rows; i++) {
+        int filerow = i + state.row_offset;
+
+        buffer_reset(row);
+
+        if (filerow >= view_count()) {
+            if (state.stats.count == 0 && i == 0) {
+                char welcome[80];
+                int welcome_length = snprintf(welcome, sizeof(welcome),
+                    "Todo App -- version %s", TODO_VERSION);
+
+                if (welcome_length > state.screen_cols)
+                    welcome_length = state.screen_cols;
+
+                int padding = (state.screen_cols - welcome_length) / 2;
+
+                if (padding) {
+                    buffer_append_char(row, '~');
+                    padding--;
+                }
+
+                while (padding--) buffer_append_char(row, ' ');
+
+                buffer_append(row, welcome, welcome_length);
+            } else {
+                buffer_append_char(row, '~');
+            }
+        } else {
+            int at = view_index(filerow);
+
+            render_todo(row, get_todo(at), list_done(&state.todos, at), at);
+        }
+
+        frame_row(&state.frame, content, i, row);
+    }
+
+    trace_end(&state.trace, &span, "render");
+}
+
+void render_hud(struct buffer *dest) {
+    char hud[128];
+    int length = snprintf(hud, sizeof(hud),
+        "  [frame %.2fms p99 %.2fms %luB %lu alloc %lu sys]",
+        state.trace.last / 1e6, trace_percentile(&state.trace, 99) / 1e6,
+        state.trace.last_counters.bytes, state.trace.last_counters.allocations,
+        state.trace.last_counters.syscalls);
+
+    buffer_append(dest, hud, length < (int) sizeof(hud) ? length : (int) sizeof(hud) - 1);
+}
+
+void render_status_bar(struct buffer *dest) {
+    buffer_append(dest, "\x1b[7m", 4);
+
+    int start = dest->length;
+
+    buffer_append_int(dest, view_rank(state.cursor.y) + 1, 2);
+    buffer_append(dest, " - ", 3);
+    buffer_append_int(dest, state.stats.todo, 2);
+    buffer_append_char(dest, '/');
+    buffer_append_int(dest, state.stats.done, 2);
+    buffer_append_char(dest, '/');
+    buffer_append_int(dest, state.stats.count, 2);
+
+    if (state.view == VIEW_OPEN) {
+        buffer_append(dest, "  open", 6);
+    } else if (state.view == VIEW_DONE) {
+        buffer_append(dest, "  done", 6);
+    }
+
+    if (state.load.active) {
+        buffer_append(dest, "  loading ", 10);
+        buffer_append_int(dest, load_progress(), 0);
+        buffer_append_char(dest, '%');
+    }
+
+    if (state.filter.active) {
+        buffer_append(dest, "  filter \"", 10);
+        buffer_append(dest, state.filter.query, state.filter.length);
+        buffer_append(dest, "\" ", 2);
+        buffer_append_int(dest, state.filter.count, 0);
+    }
+
+    if (state.trace.hud) render_hud(dest);
+
+#ifdef _DEBUG
+    buffer_append(dest, "  [", 3);
+    buffer_append_int(dest, state.frame.last_bytes, 0);
+    buffer_append(dest, " bytes]", 7);
+
+    struct arena_stats stats;
+    arena_stats(&state.todos.arena, &stats);
+
+    buffer_append(dest, "  [", 3);
+    buffer_append_int(dest, stats.fragmentation, 0);
+    buffer_append(dest, "% fragmented]", 13);
+#endif
+
+    int length = dest->length - start;
+
+    if (length > state.screen_cols) {
+        dest->length = start + state.screen_cols;
+        length = state.screen_cols;
+    }
+
+    while (length < state.screen_cols) {
+        buffer_append_char(dest, ' ');
+        length++;
+    }
+
+    buffer_append(dest, "\x1b[m", 3);
+}
+
+void render_search_prompt(struct buffer *dest) {
+    buffer_append_char(dest, '/');
+    buffer_append(dest, state.search.query, state.search.length);
+
+    if (state.search.length) {
+        buffer_append(dest, "  [", 3);
+        buffer_append_int(dest, state.search.matches, 0);
+        buffer_append(dest, " matches]", 9);
+    }
+
+    if (dest->length > state.screen_cols) dest->length = state.screen_cols;
+}
+
+void render_filter_prompt(struct buffer *dest) {
+    buffer_append(dest, "filter: ", 8);
+    buffer_append(dest, state.filter.query, state.filter.length);
+
+    if (state.filter.active) {
+        buffer_append(dest, "  [", 3);
+        buffer_append_int(dest, state.filter.count, 0);
+        buffer_append(dest, " matches]", 9);
+    }
+
+    if (dest->length > state.screen_cols) dest->length = state.screen_cols;
+}
+
+void render_status_message(struct buffer *dest) {
+    if (state.work_mode == WM_SEARCH) {
+        render_search_prompt(dest);
+        return;
+    }
+
+    if (state.work_mode == WM_FILTER) {
+        render_filter_prompt(dest);
+        return;
+    }
+
+    int message_length = strlen(state.status_message);
+
+    if (message_length > state.screen_cols)
+        message_length = state.screen_cols;
+
+    if (message_length && time(NULL) - state.status_message_time < 5)
+        buffer_append(dest, state.status_message, message_length);
+}
+
+void render_screen() {
+    scrolling();
+    frame_resize(&state.frame, state.screen_rows + 2, state.screen_cols);
+    row_cache_resize(&state.rows, state.screen_rows * 2);
+
+    if (!state.frame.valid) row_cache_clear(&state.rows);
+
+    struct buffer *content = &state.output;
+    struct buffer *row = &state.line;
+
+    buffer_reset(content);
+    buffer_append(content, "\x1b[?25l", 6);
+
+    render(content);
+
+    buffer_reset(row);
+    render_status_bar(row);
+    frame_row(&state.frame, content, state.screen_rows, row);
+
+    buffer_reset(row);
+    render_status_message(row);
+    frame_row(&state.frame, content, state.screen_rows + 1, row);
+
+    if (state.work_mode == WM_SEARCH) {
+        buffer_append_cursor(content, state.screen_rows + 2, state.search.length + 2);
+    } else if (state.work_mode == WM_FILTER) {
+        buffer_append_cursor(content, state.screen_rows + 2, state.filter.length + 9);
+    } else {
+        buffer_append_cursor(content, (view_rank(state.cursor.y) - state.row_offset) + 1,
+            state.cursor.x + 1);
+    }
+
+    if (state.work_mode != WM_NORMAL) {
+        buffer_append(content, "\x1b[?25h", 6);
+    }
+}
+
+void refresh_screen() {
+    struct trace_span span;
+
+    trace_wake(&state.trace);
+    trace_begin(&state.trace, &span);
+
+    render_screen();
+
+    int length = state.output.length;
+
+    if (buffer_flush(&state.output, STDOUT_FILENO) == -1) die("write");
+
+    frame_commit(&state.frame, length);
+
+    trace_end(&state.trace, &span, "refresh_screen");
+    trace_frame(&state.trace);
+}
+
+void when_open(char *filename) {
+    struct trace_span span;
+
+    trace_begin(&state.trace, &span);
+
+    free(state.filename);
+    state.filename = strdup(filename);
+
+    if (!state.batch && trigram_init(&state.trigram) == -1) die("trigram_init");
+
+    if (!state.batch && remote_open(filename) == 0) {
+        load_rows(state.screen_rows);
+        trace_end(&state.trace, &span, "when_open");
+        return;
+    }
+
+    int file = open(filename, O_RDONLY | O_CREAT, 0644);
+    if (file == -1) die("open");
+
+    struct stat st;
+    if (fstat(file, &st) == -1) die("fstat");
+
+    struct snapshot snapshot;
+
+    if (st.st_size > 0 && snapshot_open(&snapshot, filename, file, &st) == 0) {
+        state.map = snapshot.map;
+        state.map_length = snapshot.length;
+
+        if (list_map(&state.todos, snapshot.map, snapshot.length) == -1) {
+            die("list_map");
+        }
+
+        load_snapshot(&snapshot);
+    } else if (st.st_size > 0) {
+        load_todos(file, st.st_size);
+    }
+
+    close(file);
+
+    if (st.st_size == 0) when_loaded();
+
+    trace_end(&state.trace, &span, "when_open");
+}
+
+void update_window_size() {
+    int rows, cols;
+
+    if (get_window_size(&rows, &cols) == -1) {
+        die("get_window_size");
+    }
+
+    state.screen_rows = rows - 2;
+    state.screen_cols = cols;
+}
+
+void on_window_change(int sig) {
+    int saved = errno;
+
+    (void) sig;
+    write(state.wakeup[1], "w", 1);
+    errno = saved;
+}
+
+void when_wakeup() {
+    char events[64];
+    int loaded = 0;
+    ssize_t n;
+
+    while ((n = read(state.wakeup[0], events, sizeof(events))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (events[i] == 'w') update_window_size();
+            if (events[i] == 'l') loaded = 1;
+
+            if (events[i] == 's' &&
+                writer_message(&state.writer, state.status_message,
+                    sizeof(state.status_message))) {
+                state.status_message_time = time(NULL);
+            }
+        }
+    }
+
+    if (loaded) load_ready();
+}
+
+int status_timeout() {
+    if (state.status_message[0] == '\0') return -1;
+
+    time_t elapsed = time(NULL) - state.status_message_time;
+
+    return elapsed < 5 ? (5 - elapsed) * 1000 : -1;
+}
+
+int idle_timeout() {
+    if (load_pending()) return 0;
+
+    int timeout = status_timeout();
+
+    if (arena_fragmented(&state.todos.arena) &&
+        (timeout == -1 || timeout > TODO_IDLE_TIMEOUT)) {
+        timeout = TODO_IDLE_TIMEOUT;
+    }
+
+    return timeout;
+}
+
+void wait_for_events() {
+    int remote = state.remote.active && state.work_mode != WM_INSERT;
+    struct pollfd fds[4] = {
+        { STDIN_FILENO, POLLIN, 0 },
+        { state.wakeup[0], POLLIN, 0 },
+        { state.watch.fd, POLLIN, 0 },
+        { remote ? state.remote.stream.fd : -1, POLLIN, 0 }
+    };
+
+    if (state.merge.pending && state.work_mode == WM_NORMAL) {
+        when_changed();
+        return;
+    }
+
+    if (remote && state.remote.resync) {
+        remote_resync();
+        return;
+    }
+
+    int timeout = idle_timeout();
+    int pending = input_timeout(&state.input);
+
+    if (pending != -1 && (timeout == -1 || pending < timeout)) timeout = pending;
+
+    int ready = poll(fds, 4, timeout);
+
+    trace_counters.syscalls++;
+    trace_wake(&state.trace);
+
+    if (ready == -1) {
+        if (errno == EINTR) return;
+        die("poll");
+    }
+
+    if (ready == 0) {
+        process_keys(input_timeout(&state.input) == 0);
+        load_ready();
+        if (arena_fragmented(&state.todos.arena)) compact_text();
+        return;
+    }
+
+    if (fds[1].revents & POLLIN) when_wakeup();
+
+    if (fds[2].revents & POLLIN && watch_changed(&state.watch)) {
+        state.merge.pending = 1;
+    }
+
+    if (fds[3].revents & (POLLIN | POLLHUP | POLLERR)) remote_receive();
+
+    if (fds[0].revents & POLLIN) {
+        if (input_read(&state.input, STDIN_FILENO) == -1) die("read");
+        process_keys(0);
+    } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+        when_quit();
+    }
+}
+
+void init() {
+    state.cursor.x = 3;
+    state.cursor.y = 0;
+    state.stats.count = 0;
+    state.todos = (struct todo_list) LIST_INIT;
+    state.editor = (todo) { 0, NULL, 0, 0 };
+    state.trigram = (struct trigram_index) TRIGRAM_INIT;
+    state.filter.pending = -1;
+    state.frame = (struct frame) FRAME_INIT;
+    state.rows = (struct row_cache) ROW_CACHE_INIT;
+    state.output = (struct buffer) BUFFER_INIT;
+    state.line = (struct buffer) BUFFER_INIT;
+    state.map = NULL;
+    state.map_length = 0;
+    state.row_offset = 0;
+    state.work_mode = WM_NORMAL;
+    state.status_message[0] = '\0';
+    state.status_message_time = 0;
+    state.insertion_mode = IM_AFTER;
+    state.insertion_new = 0;
+    state.journal.fd = -1;
+    state.journal.path = NULL;
+    state.load.active = 0;
+    state.merge.base = NULL;
+    state.merge.saves = NULL;
+    state.merge.save_count = 0;
+    state.merge.save_capacity = 0;
+    state.merge.pending = 0;
+    state.watch = (struct watch) WATCH_INIT;
+    state.remote.stream = (struct protocol_stream) PROTOCOL_STREAM_INIT;
+    state.remote.active = 0;
+    state.serve.server = (struct server) SERVER_INIT;
+    state.serve.version = 0;
+    state.trace = (struct trace) TRACE_INIT;
+
+    state.input.start = 0;
+    state.input.length = 0;
+
+    if (pipe(state.wakeup) == -1) die("pipe");
+
+    fcntl(state.wakeup[0], F_SETFL, O_NONBLOCK);
+    fcntl(state.wakeup[1], F_SETFL, O_NONBLOCK);
+}
+
+void init_window() {
+    update_window_size();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_window_change;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGWINCH, &action, NULL) == -1) die("sigaction");
+}
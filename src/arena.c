@@ -0,0 +1,168 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "trace.h"
+
+int arena_map(struct arena *arena, const char *base, size_t length) {
+    if (length >= ARENA_NONE || arena->length) {
+        errno = EFBIG;
+        return -1;
+    }
+
+    arena->base = base;
+    arena->base_length = length;
+
+    return 0;
+}
+
+void arena_bulk(struct arena *arena, int bulk) {
+    arena->bulk = bulk;
+}
+
+int arena_class(int length) {
+    int class = 0;
+    int size = ARENA_MIN_CLASS;
+
+    while (size < length) {
+        size *= 2;
+        class++;
+    }
+
+    return class;
+}
+
+uint32_t arena_size(int length) {
+    if (length <= ARENA_MIN_CLASS << (ARENA_CLASSES - 1))
+        return ARENA_MIN_CLASS << arena_class(length);
+
+    return (length + ARENA_MIN_CLASS - 1) & ~(ARENA_MIN_CLASS - 1);
+}
+
+int arena_reserve(struct arena *arena, uint32_t size) {
+    if ((uint64_t) arena->base_length + arena->length + size >= ARENA_NONE)
+        return -1;
+
+    if (arena->length + size <= arena->capacity) return 0;
+
+    uint64_t capacity = arena->capacity ? arena->capacity : ARENA_MIN_CAPACITY;
+
+    while (capacity < (uint64_t) arena->length + size) capacity *= 2;
+    if (capacity > ARENA_NONE - arena->base_length)
+        capacity = ARENA_NONE - arena->base_length;
+
+    char *heap = realloc(arena->heap, capacity);
+
+    if (heap == NULL) return -1;
+
+    arena->heap = heap;
+    arena->capacity = capacity;
+    trace_counters.allocations++;
+
+    return 0;
+}
+
+void arena_push(struct arena *arena, int class, uint32_t offset) {
+    memcpy(&arena->heap[offset - arena->base_length],
+        &arena->free_lists[class], sizeof(uint32_t));
+    arena->free_lists[class] = offset;
+    arena->free += ARENA_MIN_CLASS << class;
+}
+
+uint32_t arena_pop(struct arena *arena, int class) {
+    uint32_t offset = arena->free_lists[class];
+
+    memcpy(&arena->free_lists[class],
+        &arena->heap[offset - arena->base_length], sizeof(uint32_t));
+    arena->free -= ARENA_MIN_CLASS << class;
+
+    return offset;
+}
+
+uint32_t arena_bump(struct arena *arena, uint32_t size) {
+    if (arena_reserve(arena, size) == -1) return ARENA_NONE;
+
+    uint32_t offset = arena->base_length + arena->length;
+    arena->length += size;
+
+    return offset;
+}
+
+int arena_slab(struct arena *arena, int class) {
+    uint32_t size = ARENA_MIN_CLASS << class;
+    uint32_t offset = arena_bump(arena, ARENA_SLAB_SIZE);
+
+    if (offset == ARENA_NONE) return -1;
+
+    for (uint32_t at = ARENA_SLAB_SIZE; at >= size; at -= size) {
+        arena_push(arena, class, offset + at - size);
+    }
+
+    return 0;
+}
+
+uint32_t arena_store(struct arena *arena, const char *string, int length) {
+    if (arena->base && string >= arena->base &&
+        string + length <= arena->base + arena->base_length) {
+        return string - arena->base;
+    }
+
+    uint32_t size = arena_size(length);
+    uint32_t offset;
+    int class = arena_class(length);
+
+    if (class >= ARENA_CLASSES || arena->bulk) {
+        offset = arena_bump(arena, size);
+    } else {
+        if (arena->free_lists[class] == ARENA_NONE &&
+            arena_slab(arena, class) == -1) return ARENA_NONE;
+
+        offset = arena_pop(arena, class);
+    }
+
+    if (offset == ARENA_NONE) return ARENA_NONE;
+
+    memcpy(&arena->heap[offset - arena->base_length], string, length);
+    arena->live += size;
+    arena->text += length;
+
+    return offset;
+}
+
+void arena_release(struct arena *arena, uint32_t offset, int length) {
+    if (offset < arena->base_length) return;
+
+    uint32_t size = arena_size(length);
+    int class = arena_class(length);
+
+    arena->live -= size;
+    arena->text -= length;
+
+    if (class < ARENA_CLASSES) arena_push(arena, class, offset);
+}
+
+const char *arena_get(const struct arena *arena, uint32_t offset) {
+    if (offset < arena->base_length) return &arena->base[offset];
+
+    return &arena->heap[offset - arena->base_length];
+}
+
+int arena_fragmented(const struct arena *arena) {
+    uint32_t idle = arena->length - arena->live;
+
+    return idle > ARENA_COMPACT_SIZE && idle > arena->live;
+}
+
+void arena_stats(const struct arena *arena, struct arena_stats *stats) {
+    stats->live = arena->text;
+    stats->used = arena->length;
+    stats->capacity = arena->capacity;
+    stats->fragmentation = arena->length ?
+        (int) ((uint64_t) (arena->length - arena->text) * 100 / arena->length) : 0;
+}
+
+void arena_free(struct arena *arena) {
+    free(arena->heap);
+    *arena = (struct arena) ARENA_INIT;
+}
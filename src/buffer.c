@@ -1,15 +1,115 @@
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
 #include "buffer.h"
+#include "trace.h"
 
-void buffer_append(struct buffer *dest, const char *string, int length) {
-    char *new = realloc(dest->string, dest->length + length);
+int buffer_reserve(struct buffer *dest, int length) {
+    if (dest->length + length <= dest->capacity) return 0;
+
+    int capacity = dest->capacity ? dest->capacity : BUFFER_MIN_CAPACITY;
+
+    while (capacity < dest->length + length) capacity *= 2;
+
+    char *new = realloc(dest->string, capacity);
 
-    if (new == NULL) return;
+    if (new == NULL) return -1;
 
-    memcpy(&new[dest->length], string, length);
     dest->string = new;
+    dest->capacity = capacity;
+    trace_counters.allocations++;
+
+    return 0;
+}
+
+void buffer_append(struct buffer *dest, const char *string, int length) {
+    if (length <= 0 || buffer_reserve(dest, length) == -1) return;
+
+    memcpy(&dest->string[dest->length], string, length);
     dest->length += length;
 }
 
+void buffer_append_char(struct buffer *dest, char c) {
+    if (buffer_reserve(dest, 1) == -1) return;
+
+    dest->string[dest->length++] = c;
+}
+
+int buffer_format_int(char *dest, long long value) {
+    char digits[24];
+    int length = 0;
+    unsigned long long magnitude = value < 0 ?
+        -(unsigned long long) value : (unsigned long long) value;
+
+    do {
+        digits[length++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) digits[length++] = '-';
+
+    for (int i = 0; i < length; i++) dest[i] = digits[length - 1 - i];
+
+    return length;
+}
+
+void buffer_append_int(struct buffer *dest, int value, int width) {
+    char digits[24];
+    int length = buffer_format_int(digits, value);
+
+    if (buffer_reserve(dest, (width > length ? width : length)) == -1) return;
+
+    while (width-- > length) dest->string[dest->length++] = ' ';
+
+    memcpy(&dest->string[dest->length], digits, length);
+    dest->length += length;
+}
+
+void buffer_append_cursor(struct buffer *dest, int row, int col) {
+    buffer_append(dest, "\x1b[", 2);
+    buffer_append_int(dest, row, 0);
+    buffer_append_char(dest, ';');
+    buffer_append_int(dest, col, 0);
+    buffer_append_char(dest, 'H');
+}
+
+void buffer_reset(struct buffer *dest) {
+    dest->length = 0;
+}
+
+int buffer_flush(struct buffer *src, int fd) {
+    int written = 0;
+
+    while (written < src->length) {
+        ssize_t n = write(fd, &src->string[written], src->length - written);
+
+        trace_counters.syscalls++;
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                if (poll(&pfd, 1, -1) == -1 && errno != EINTR) return -1;
+                continue;
+            }
+
+            return -1;
+        }
+
+        written += n;
+        trace_counters.bytes += n;
+    }
+
+    src->length = 0;
+
+    return written;
+}
+
 void buffer_free(struct buffer *target) {
     free(target->string);
+    target->string = NULL;
+    target->length = 0;
+    target->capacity = 0;
 }
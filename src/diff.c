@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff.h"
+
+uint64_t diff_hash(const char *string, int length, int done) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (done ? 0x2d : 0x20);
+
+    hash *= 0x100000001b3ULL;
+
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char) string[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+int diff_push(struct diff_hunk **hunks, int *count, int *capacity,
+    int a_start, int a_end, int b_start, int b_end) {
+    if (a_start == a_end && b_start == b_end) return 0;
+
+    if (*count == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 16;
+        struct diff_hunk *resized = realloc(*hunks, sizeof(struct diff_hunk) * grown);
+
+        if (resized == NULL) return -1;
+
+        *hunks = resized;
+        *capacity = grown;
+    }
+
+    struct diff_hunk hunk = { a_start, a_end, b_start, b_end };
+    (*hunks)[(*count)++] = hunk;
+
+    return 0;
+}
+
+int diff_middle(const uint64_t *a, int n, const uint64_t *b, int m, int *matches) {
+    int max = n + m < DIFF_MAX_EDITS ? n + m : DIFF_MAX_EDITS;
+    int *v = malloc(sizeof(int) * (2 * max + 3));
+    int *trace = malloc(sizeof(int) * (size_t) (max + 1) * (max + 1));
+    int found = -1;
+
+    if (v == NULL || trace == NULL) {
+        free(v);
+        free(trace);
+        return -2;
+    }
+
+    v[max + 2] = 0;
+
+    for (int d = 0; d <= max && found == -1; d++) {
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+
+            if (k == -d || (k != d && v[max + 1 + k - 1] < v[max + 1 + k + 1])) {
+                x = v[max + 1 + k + 1];
+            } else {
+                x = v[max + 1 + k - 1] + 1;
+            }
+
+            int y = x - k;
+
+            while (x < n && y < m && a[x] == b[y]) {
+                x++;
+                y++;
+            }
+
+            v[max + 1 + k] = x;
+
+            if (x >= n && y >= m) found = d;
+        }
+
+        for (int k = -d; k <= d; k += 2) {
+            trace[(size_t) d * d + (k + d) / 2] = v[max + 1 + k];
+        }
+    }
+
+    int count = 0;
+
+    if (found != -1) {
+        int x = n;
+        int y = m;
+
+        for (int d = found; d >= 0; d--) {
+            int k = x - y;
+            int previous_x = 0;
+            int previous_y = 0;
+
+            if (d > 0) {
+                const int *row = &trace[(size_t) (d - 1) * (d - 1)];
+                int previous_k;
+
+                if (k == -d || (k != d &&
+                    row[(k - 1 + d - 1) / 2] < row[(k + 1 + d - 1) / 2])) {
+                    previous_k = k + 1;
+                } else {
+                    previous_k = k - 1;
+                }
+
+                previous_x = row[(previous_k + d - 1) / 2];
+                previous_y = previous_x - previous_k;
+            }
+
+            while (x > previous_x && y > previous_y) {
+                x--;
+                y--;
+                matches[2 * count] = x;
+                matches[2 * count + 1] = y;
+                count++;
+            }
+
+            x = previous_x;
+            y = previous_y;
+        }
+    }
+
+    free(v);
+    free(trace);
+
+    return found == -1 ? -1 : count;
+}
+
+int diff_lines(const uint64_t *a, int a_count, const uint64_t *b, int b_count,
+    struct diff_hunk **hunks, int *count) {
+    int prefix = 0;
+    int suffix = 0;
+    int capacity = 0;
+
+    *hunks = NULL;
+    *count = 0;
+
+    while (prefix < a_count && prefix < b_count && a[prefix] == b[prefix]) prefix++;
+
+    while (suffix < a_count - prefix && suffix < b_count - prefix &&
+        a[a_count - 1 - suffix] == b[b_count - 1 - suffix]) suffix++;
+
+    int n = a_count - prefix - suffix;
+    int m = b_count - prefix - suffix;
+    int *matches = malloc(sizeof(int) * 2 * ((n < m ? n : m) + 1));
+
+    if (matches == NULL) return -1;
+
+    int matched = n && m ? diff_middle(&a[prefix], n, &b[prefix], m, matches) : 0;
+
+    if (matched == -2) {
+        free(matches);
+        return -1;
+    }
+
+    int coarse = matched == -1;
+
+    if (coarse) matched = 0;
+
+    int x = 0;
+    int y = 0;
+    int result = 0;
+
+    for (int i = matched - 1; i >= 0 && result == 0; i--) {
+        result = diff_push(hunks, count, &capacity, prefix + x,
+            prefix + matches[2 * i], prefix + y, prefix + matches[2 * i + 1]);
+        x = matches[2 * i] + 1;
+        y = matches[2 * i + 1] + 1;
+    }
+
+    if (result == 0) {
+        result = diff_push(hunks, count, &capacity, prefix + x, prefix + n,
+            prefix + y, prefix + m);
+    }
+
+    free(matches);
+
+    if (result == -1) {
+        free(*hunks);
+        *hunks = NULL;
+        *count = 0;
+        return -1;
+    }
+
+    return coarse ? DIFF_COARSE : 0;
+}
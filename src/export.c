@@ -0,0 +1,175 @@
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "export.h"
+#include "search.h"
+#include "todo.h"
+
+char *export_json(char *p, const char *string, int length) {
+    static const char hex[] = "0123456789abcdef";
+
+    *p++ = '"';
+
+    for (int i = 0; i < length; i++) {
+        unsigned char c = string[i];
+
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            *p++ = c;
+        } else if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c == '\t') {
+            *p++ = '\\';
+            *p++ = 't';
+        } else {
+            memcpy(p, "\\u00", 4);
+            p[4] = hex[c >> 4];
+            p[5] = hex[c & 15];
+            p += 6;
+        }
+    }
+
+    *p++ = '"';
+
+    return p;
+}
+
+char *export_csv(char *p, const char *string, int length) {
+    if (memchr(string, '"', length) == NULL && memchr(string, ',', length) == NULL &&
+        memchr(string, '\r', length) == NULL) {
+        memcpy(p, string, length);
+        return p + length;
+    }
+
+    *p++ = '"';
+
+    for (int i = 0; i < length; i++) {
+        if (string[i] == '"') *p++ = '"';
+        *p++ = string[i];
+    }
+
+    *p++ = '"';
+
+    return p;
+}
+
+void export_item(struct buffer *dest, int format, long long index, int done,
+    const char *string, int length) {
+    if (buffer_reserve(dest, length * 6 + 64) == -1) return;
+
+    char *start = &dest->string[dest->length];
+    char *p = start;
+
+    switch (format) {
+        case EXPORT_TEXT:
+            memcpy(p, string, length);
+            p += length;
+            break;
+        case EXPORT_JSON:
+            memcpy(p, "{\"index\":", 9);
+            p += 9;
+            p += buffer_format_int(p, index);
+            memcpy(p, done ? ",\"done\":true,\"text\":" : ",\"done\":false,\"text\":",
+                done ? 20 : 21);
+            p = export_json(p + (done ? 20 : 21), string, length);
+            *p++ = '}';
+            break;
+        case EXPORT_CSV:
+            p += buffer_format_int(p, index);
+            memcpy(p, done ? ",1," : ",0,", 3);
+            p = export_csv(p + 3, string, length);
+            break;
+    }
+
+    *p++ = '\n';
+    dest->length += p - start;
+}
+
+int export_lines(struct buffer *dest, const char *line, const char *end,
+    int last, long long *index, const struct export_options *options,
+    int ignore_case) {
+    const char *start = line;
+
+    while (line < end) {
+        const char *eol = memchr(line, '\n', end - line);
+
+        if (eol == NULL) {
+            if (!last) break;
+            eol = end;
+        }
+
+        size_t length = eol - line;
+
+        while (length > 0 && line[length - 1] == '\r') length--;
+
+        if (is_todo_line(line, length)) {
+            int done = line[0] == '-';
+
+            (*index)++;
+
+            if ((options->filter != EXPORT_OPEN || !done) &&
+                (options->filter != EXPORT_DONE || done) &&
+                search_find(&line[2], length - 2, options->query,
+                    options->query_length, ignore_case) != -1) {
+                export_item(dest, options->format, *index, done, &line[2], length - 2);
+            }
+        }
+
+        line = eol < end ? eol + 1 : end;
+    }
+
+    return line - start;
+}
+
+int export_stream(int in, int out, const struct export_options *options) {
+    struct buffer block = BUFFER_INIT;
+    struct buffer output = BUFFER_INIT;
+    int ignore_case = !search_has_upper(options->query, options->query_length);
+    long long index = 0;
+    int result = 0;
+
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if (options->format == EXPORT_CSV) buffer_append(&output, "index,done,text\n", 16);
+
+    while (1) {
+        if (buffer_reserve(&block, EXPORT_BLOCK_SIZE) == -1) {
+            result = -1;
+            break;
+        }
+
+        ssize_t n = read(in, &block.string[block.length], block.capacity - block.length);
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            result = -1;
+            break;
+        }
+
+        block.length += n;
+
+        int used = export_lines(&output, block.string, block.string + block.length,
+            n == 0, &index, options, ignore_case);
+
+        block.length -= used;
+        memmove(block.string, &block.string[used], block.length);
+
+        if ((n == 0 || output.length >= EXPORT_BLOCK_SIZE) &&
+            buffer_flush(&output, out) == -1) {
+            result = -1;
+            break;
+        }
+
+        if (n == 0) break;
+    }
+
+    buffer_free(&block);
+    buffer_free(&output);
+
+    return result;
+}
@@ -0,0 +1,54 @@
+#include "frame.h"
+
+uint64_t frame_hash(const char *string, int length) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char) string[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+void frame_resize(struct frame *frame, int rows, int cols) {
+    if (frame->rows == rows && frame->cols == cols) return;
+
+    free(frame->hashes);
+    frame->hashes = calloc(rows, sizeof(uint64_t));
+    frame->rows = frame->hashes ? rows : 0;
+    frame->cols = cols;
+    frame->valid = 0;
+}
+
+void frame_invalidate(struct frame *frame) {
+    frame->valid = 0;
+}
+
+void frame_row(struct frame *frame, struct buffer *dest, int y, struct buffer *row) {
+    uint64_t hash = frame_hash(row->string, row->length);
+
+    if (y >= frame->rows) return;
+    if (frame->valid && frame->hashes[y] == hash) return;
+
+    buffer_append_cursor(dest, y + 1, 1);
+    buffer_append(dest, row->string, row->length);
+    buffer_append(dest, "\x1b[K", 3);
+
+    frame->hashes[y] = hash;
+}
+
+void frame_commit(struct frame *frame, int bytes) {
+    frame->valid = 1;
+    frame->last_bytes = bytes;
+    frame->total_bytes += bytes;
+    frame->count++;
+}
+
+void frame_free(struct frame *frame) {
+    free(frame->hashes);
+    frame->hashes = NULL;
+    frame->rows = 0;
+    frame->cols = 0;
+    frame->valid = 0;
+}
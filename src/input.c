@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "trace.h"
+
+#define INPUT_IGNORED -1
+
+long input_clock() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+int input_read(struct input *input, int fd) {
+    if (input->start > 0) {
+        memmove(input->buffer, &input->buffer[input->start], input->length);
+        input->start = 0;
+    }
+
+    ssize_t n;
+
+    do {
+        n = read(fd, &input->buffer[input->length],
+            INPUT_BUFFER_SIZE - input->length);
+        trace_counters.syscalls++;
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1) return errno == EAGAIN ? 0 : -1;
+
+    input->length += n;
+    input->received = input_clock();
+
+    return n;
+}
+
+int input_timeout(const struct input *input) {
+    if (input->length == 0 && !input->pasting) return -1;
+
+    long limit = input->pasting ? INPUT_PASTE_TIMEOUT : INPUT_ESCAPE_TIMEOUT;
+    long remaining = input->received + limit - input_clock();
+
+    return remaining > 0 ? remaining : 0;
+}
+
+int input_decode_escape(const char *seq, int length, int *key) {
+    if (length < 2) return 0;
+
+    *key = INPUT_IGNORED;
+
+    if (seq[1] == '\r') {
+        *key = ALT_ENTER;
+        return 2;
+    }
+
+    if (seq[1] == '\x1b') {
+        *key = '\x1b';
+        return 1;
+    }
+
+    if (seq[1] == 'O') {
+        if (length < 3) return 0;
+
+        switch (seq[2]) {
+            case 'A': *key = ARROW_UP; break;
+            case 'B': *key = ARROW_DOWN; break;
+            case 'C': *key = ARROW_RIGHT; break;
+            case 'D': *key = ARROW_LEFT; break;
+            case 'H': *key = HOME_KEY; break;
+            case 'F': *key = END_KEY; break;
+        }
+
+        return 3;
+    }
+
+    if (seq[1] != '[') return 2;
+
+    int number = 0;
+    int plain = 1;
+    int i = 2;
+
+    while (i < length && seq[i] >= 0x30 && seq[i] <= 0x3f) {
+        if (seq[i] >= '0' && seq[i] <= '9' && number < 1000) {
+            number = number * 10 + seq[i] - '0';
+        } else {
+            plain = 0;
+        }
+
+        i++;
+    }
+
+    while (i < length && seq[i] >= 0x20 && seq[i] <= 0x2f) {
+        plain = 0;
+        i++;
+    }
+
+    if (i == length) return 0;
+    if (seq[i] < 0x40 || seq[i] > 0x7e) return i;
+
+    if (i == 2) {
+        switch (seq[i]) {
+            case 'A': *key = ARROW_UP; break;
+            case 'B': *key = ARROW_DOWN; break;
+            case 'C': *key = ARROW_RIGHT; break;
+            case 'D': *key = ARROW_LEFT; break;
+            case 'H': *key = HOME_KEY; break;
+            case 'F': *key = END_KEY; break;
+            case 'Z': *key = SHIFT_TAB; break;
+        }
+    } else if (plain && seq[i] == '~') {
+        switch (number) {
+            case 1: *key = HOME_KEY; break;
+            case 3: *key = DEL_KEY; break;
+            case 4: *key = END_KEY; break;
+            case 5: *key = PAGE_UP; break;
+            case 6: *key = PAGE_DOWN; break;
+            case 7: *key = HOME_KEY; break;
+            case 8: *key = END_KEY; break;
+            case 200: *key = PASTE_BEGIN; break;
+        }
+    }
+
+    return i + 1;
+}
+
+void input_consume(struct input *input, int length) {
+    input->start += length;
+    input->length -= length;
+
+    if (input->length == 0) input->start = 0;
+}
+
+int input_next_paste(struct input *input, int *key, int final) {
+    const char *data = &input->buffer[input->start];
+    const char *end = memmem(data, input->length, PASTE_END, PASTE_END_LENGTH);
+
+    if (end || final) {
+        int length = end ? end - data : input->length;
+
+        buffer_append(&input->paste, data, length);
+        input_consume(input, end ? length + PASTE_END_LENGTH : length);
+        input->pasting = 0;
+        *key = PASTE_KEY;
+        return 1;
+    }
+
+    int keep = PASTE_END_LENGTH - 1;
+    if (keep > input->length) keep = input->length;
+
+    buffer_append(&input->paste, data, input->length - keep);
+    input_consume(input, input->length - keep);
+
+    return 0;
+}
+
+int input_next(struct input *input, int *key, int final) {
+    while (input->length > 0 || input->pasting) {
+        if (input->pasting) return input_next_paste(input, key, final);
+
+        const char *seq = &input->buffer[input->start];
+        int consumed = 1;
+
+        if (seq[0] == '\x1b') {
+            consumed = input_decode_escape(seq, input->length, key);
+
+            if (consumed == 0) {
+                if (!final) return 0;
+
+                *key = '\x1b';
+                consumed = input->length;
+            }
+        } else {
+            *key = (unsigned char) seq[0];
+        }
+
+        input_consume(input, consumed);
+
+        if (*key == INPUT_IGNORED) continue;
+        if (*key != PASTE_BEGIN) return 1;
+
+        buffer_reset(&input->paste);
+        input->pasting = 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "journal.h"
+
+int journal_header(char *dest, size_t size, struct stat *base) {
+    return snprintf(dest, size, "todo-journal %lld %lld %ld\n",
+        (long long) base->st_size, (long long) base->st_mtim.tv_sec,
+        (long) base->st_mtim.tv_nsec);
+}
+
+int journal_write(struct journal *journal, const char *string, size_t length) {
+    size_t written = 0;
+
+    if (journal->fd == -1) return 0;
+
+    while (written < length) {
+        ssize_t n = write(journal->fd, &string[written], length - written);
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            if (ftruncate(journal->fd, journal->length) == -1) {}
+            errno = saved;
+            return -1;
+        }
+
+        written += n;
+    }
+
+    journal->length += length;
+
+    return length;
+}
+
+int journal_record(struct journal *journal, const char *head, int head_length,
+    const char *payload, int payload_length) {
+    if (journal->fd == -1) return 0;
+
+    int length = head_length;
+
+    buffer_append(&journal->batch, head, head_length);
+
+    if (payload != NULL) {
+        buffer_append(&journal->batch, payload, payload_length);
+        buffer_append_char(&journal->batch, '\n');
+        length += payload_length + 1;
+    }
+
+    journal->recorded += length;
+
+    return journal->batching ? 0 : length;
+}
+
+char *journal_read(int fd, size_t *length) {
+    struct stat st;
+
+    if (fstat(fd, &st) == -1) return NULL;
+
+    char *content = malloc(st.st_size + 1);
+    size_t total = 0;
+
+    if (content == NULL) return NULL;
+
+    while (total < (size_t) st.st_size) {
+        ssize_t n = pread(fd, &content[total], st.st_size - total, total);
+
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        total += n;
+    }
+
+    content[total] = '\0';
+    *length = total;
+
+    return content;
+}
+
+size_t journal_replay(const char *content, size_t length,
+    const struct journal_handler *handler, int *replayed) {
+    const char *p = content;
+    const char *end = content + length;
+
+    *replayed = 0;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+
+        if (eol == NULL) break;
+
+        char type = *p;
+        char *next;
+        long at = strtol(p + 1, &next, 10);
+        long done = 0;
+        long size = 0;
+
+        if (type == 'i') {
+            done = strtol(next, &next, 10);
+        }
+
+        if (type == 'i' || type == 'e') {
+            size = strtol(next, &next, 10);
+
+            if (size < 0 || eol + 1 + size >= end || eol[1 + size] != '\n')
+                break;
+        }
+
+        if (next != eol) break;
+
+        switch (type) {
+            case 't':
+                handler->toggle(at);
+                break;
+            case 'd':
+                handler->remove(at);
+                break;
+            case 'i':
+                handler->insert(at, done != 0, eol + 1, size);
+                break;
+            case 'e':
+                handler->edit(at, eol + 1, size);
+                break;
+            default:
+                return p - content;
+        }
+
+        (*replayed)++;
+        p = (type == 'i' || type == 'e') ? eol + size + 2 : eol + 1;
+    }
+
+    return p - content;
+}
+
+int journal_open(struct journal *journal, const char *filename,
+    const struct journal_handler *handler) {
+    size_t filename_length = strlen(filename);
+
+    free(journal->path);
+    journal->path = malloc(filename_length + sizeof(JOURNAL_SUFFIX));
+    memcpy(journal->path, filename, filename_length);
+    memcpy(&journal->path[filename_length], JOURNAL_SUFFIX, sizeof(JOURNAL_SUFFIX));
+
+    journal->fd = open(journal->path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (journal->fd == -1) return -1;
+
+    struct stat base;
+    char header[80];
+
+    if (stat(filename, &base) == -1) return -1;
+
+    int header_length = journal_header(header, sizeof(header), &base);
+    size_t length;
+    char *content = journal_read(journal->fd, &length);
+
+    if (content == NULL) return -1;
+
+    int replayed = 0;
+
+    if (length >= (size_t) header_length &&
+        memcmp(content, header, header_length) == 0) {
+        size_t valid = header_length + journal_replay(&content[header_length],
+            length - header_length, handler, &replayed);
+
+        if (valid != length && ftruncate(journal->fd, valid) == -1) {
+            free(content);
+            return -1;
+        }
+
+        journal->length = valid;
+        journal->header_length = header_length;
+        journal->recorded = valid - header_length;
+    } else {
+        journal->length = 0;
+
+        if (ftruncate(journal->fd, 0) == -1 ||
+            journal_write(journal, header, header_length) == -1) {
+            free(content);
+            return -1;
+        }
+
+        journal->header_length = header_length;
+        journal->recorded = 0;
+    }
+
+    free(content);
+
+    return replayed;
+}
+
+int journal_reset(struct journal *journal, int file) {
+    if (journal->fd == -1) return 0;
+
+    struct stat base;
+    char header[80];
+
+    if (fstat(file, &base) == -1) return -1;
+
+    int header_length = journal_header(header, sizeof(header), &base);
+
+    journal->length = 0;
+    journal->header_length = header_length;
+
+    if (ftruncate(journal->fd, 0) == -1) return -1;
+
+    return journal_write(journal, header, header_length);
+}
+
+void journal_close(struct journal *journal) {
+    if (journal->fd != -1) close(journal->fd);
+    free(journal->path);
+    buffer_free(&journal->batch);
+    journal->fd = -1;
+    journal->path = NULL;
+}
+
+int journal_dirty(struct journal *journal) {
+    return journal->fd != -1 && journal->recorded > 0;
+}
+
+void journal_begin(struct journal *journal) {
+    journal->batching = 1;
+}
+
+int journal_commit(struct journal *journal) {
+    journal->batching = 0;
+
+    return journal->batch.length;
+}
+
+int journal_toggle(struct journal *journal, int at) {
+    char head[32];
+    int length = snprintf(head, sizeof(head), "t %d\n", at);
+    return journal_record(journal, head, length, NULL, 0);
+}
+
+int journal_insert(struct journal *journal, int at, int done,
+    const char *string, int length) {
+    char head[48];
+    int head_length = snprintf(head, sizeof(head), "i %d %d %d\n", at, done, length);
+    return journal_record(journal, head, head_length, string, length);
+}
+
+int journal_delete(struct journal *journal, int at) {
+    char head[32];
+    int length = snprintf(head, sizeof(head), "d %d\n", at);
+    return journal_record(journal, head, length, NULL, 0);
+}
+
+int journal_edit(struct journal *journal, int at, const char *string, int length) {
+    char head[48];
+    int head_length = snprintf(head, sizeof(head), "e %d %d\n", at, length);
+    return journal_record(journal, head, head_length, string, length);
+}
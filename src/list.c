@@ -0,0 +1,427 @@
+#include "list.h"
+#include "trace.h"
+
+#define LIST_WORD_BITS 64
+
+int list_count(const struct todo_list *list) {
+    return list->capacity - (list->gap_end - list->gap_start);
+}
+
+int list_slot(const struct todo_list *list, int at) {
+    return at < list->gap_start ? at : at + (list->gap_end - list->gap_start);
+}
+
+int list_occupied(const struct todo_list *list, int slot) {
+    if (slot <= list->gap_start) return slot;
+    if (slot >= list->gap_end) return slot - (list->gap_end - list->gap_start);
+    return list->gap_start;
+}
+
+int list_words(int capacity) {
+    return (capacity + LIST_WORD_BITS - 1) / LIST_WORD_BITS;
+}
+
+int list_bit(const struct todo_list *list, int slot) {
+    return list->done[slot / LIST_WORD_BITS] >> (slot % LIST_WORD_BITS) & 1;
+}
+
+void list_flip(struct todo_list *list, int slot) {
+    list->done[slot / LIST_WORD_BITS] ^= (uint64_t) 1 << (slot % LIST_WORD_BITS);
+}
+
+uint64_t list_range_bits(int word, int from, int to) {
+    int first = word * LIST_WORD_BITS;
+
+    if (from < first) from = first;
+    if (to > first + LIST_WORD_BITS) to = first + LIST_WORD_BITS;
+    if (from >= to) return 0;
+
+    uint64_t high = to - first == LIST_WORD_BITS ?
+        ~(uint64_t) 0 : ((uint64_t) 1 << (to - first)) - 1;
+
+    return high & ~(((uint64_t) 1 << (from - first)) - 1);
+}
+
+uint64_t list_open_bits(const struct todo_list *list, int word) {
+    return ~list->done[word] & list_range_bits(word, 0, list->capacity) &
+        ~list_range_bits(word, list->gap_start, list->gap_end);
+}
+
+void list_tree_add(struct todo_list *list, int word, int delta) {
+    int words = list_words(list->capacity);
+
+    for (word++; word <= words; word += word & -word) {
+        list->tree[word] += delta;
+    }
+}
+
+void list_tree_build(struct todo_list *list) {
+    int words = list_words(list->capacity);
+
+    memset(list->tree, 0, sizeof(int) * (words + 1));
+
+    for (int word = 1; word <= words; word++) {
+        list->tree[word] += __builtin_popcountll(list->done[word - 1]);
+
+        int parent = word + (word & -word);
+        if (parent <= words) list->tree[parent] += list->tree[word];
+    }
+}
+
+void list_move_bit(struct todo_list *list, int from, int to, int rebuild) {
+    list->slots[list->ids[to]] = to;
+
+    if (!list_bit(list, from)) return;
+
+    list_flip(list, from);
+    list_flip(list, to);
+
+    if (!rebuild && from / LIST_WORD_BITS != to / LIST_WORD_BITS) {
+        list_tree_add(list, from / LIST_WORD_BITS, -1);
+        list_tree_add(list, to / LIST_WORD_BITS, 1);
+    }
+}
+
+int list_index_of(const struct todo_list *list, int id) {
+    if (id < 0 || id >= list->id_count) return -1;
+
+    return list_occupied(list, list->slots[id]);
+}
+
+int list_new_id(struct todo_list *list) {
+    if (list->free_count) return list->free_ids[--list->free_count];
+
+    if ((list->id_count & (list->id_count - 1)) == 0) {
+        int *slots = realloc(list->slots,
+            sizeof(int) * (list->id_count ? list->id_count * 2 : 16));
+
+        if (slots == NULL) return -1;
+
+        list->slots = slots;
+        trace_counters.allocations++;
+    }
+
+    return list->id_count++;
+}
+
+void list_free_id(struct todo_list *list, int id) {
+    if (list->free_count == list->free_capacity) {
+        int capacity = list->free_capacity ? list->free_capacity * 2 : 16;
+        int *free_ids = realloc(list->free_ids, sizeof(int) * capacity);
+
+        if (free_ids == NULL) return;
+
+        list->free_ids = free_ids;
+        list->free_capacity = capacity;
+    }
+
+    list->free_ids[list->free_count++] = id;
+}
+
+void list_move_slots(struct todo_list *list, int to, int from, int count) {
+    memmove(&list->offsets[to], &list->offsets[from], sizeof(uint32_t) * count);
+    memmove(&list->lengths[to], &list->lengths[from], sizeof(uint32_t) * count);
+    memmove(&list->ids[to], &list->ids[from], sizeof(int) * count);
+}
+
+void list_move_gap(struct todo_list *list, int at) {
+    int gap = list->gap_end - list->gap_start;
+    int rebuild = 0;
+
+    if (at < list->gap_start) {
+        int moved = list->gap_start - at;
+
+        rebuild = moved > list_words(list->capacity);
+        list_move_slots(list, at + gap, at, moved);
+
+        for (int slot = list->gap_start - 1; slot >= at; slot--) {
+            list_move_bit(list, slot, slot + gap, rebuild);
+        }
+
+        list->gap_start -= moved;
+        list->gap_end -= moved;
+    } else if (at > list->gap_start) {
+        int moved = at - list->gap_start;
+
+        rebuild = moved > list_words(list->capacity);
+        list_move_slots(list, list->gap_start, list->gap_end, moved);
+
+        for (int slot = list->gap_end; slot < list->gap_end + moved; slot++) {
+            list_move_bit(list, slot, slot - gap, rebuild);
+        }
+
+        list->gap_start += moved;
+        list->gap_end += moved;
+    }
+
+    if (rebuild) list_tree_build(list);
+}
+
+void list_grow(struct todo_list *list, int capacity) {
+    if (capacity <= list->capacity) return;
+
+    int words = list_words(capacity);
+    uint32_t *offsets = realloc(list->offsets, sizeof(uint32_t) * capacity);
+    if (offsets) list->offsets = offsets;
+    uint32_t *lengths = realloc(list->lengths, sizeof(uint32_t) * capacity);
+    if (lengths) list->lengths = lengths;
+    int *ids = realloc(list->ids, sizeof(int) * capacity);
+    if (ids) list->ids = ids;
+    int *tree = realloc(list->tree, sizeof(int) * (words + 1));
+    if (tree) list->tree = tree;
+    uint64_t *done = calloc(words, sizeof(uint64_t));
+
+    if (!offsets || !lengths || !ids || !tree || !done) {
+        free(done);
+        return;
+    }
+
+    int tail = list->capacity - list->gap_end;
+    int shift = capacity - list->capacity;
+
+    list_move_slots(list, list->gap_end + shift, list->gap_end, tail);
+
+    for (int slot = 0; slot < list->capacity; slot++) {
+        if (!list_bit(list, slot)) continue;
+
+        int to = slot < list->gap_start ? slot : slot + shift;
+        done[to / LIST_WORD_BITS] |= (uint64_t) 1 << (to % LIST_WORD_BITS);
+    }
+
+    free(list->done);
+
+    list->done = done;
+    list->gap_end += shift;
+    list->capacity = capacity;
+    trace_counters.allocations += 5;
+
+    for (int slot = list->gap_end; slot < capacity; slot++) {
+        list->slots[list->ids[slot]] = slot;
+    }
+
+    list_tree_build(list);
+}
+
+void list_reserve(struct todo_list *list, int count) {
+    list_grow(list, list_count(list) + count);
+}
+
+int list_map(struct todo_list *list, const char *base, size_t length) {
+    return arena_map(&list->arena, base, length);
+}
+
+todo list_text(const struct todo_list *list, int at) {
+    int slot = list_slot(list, at);
+    int length = list->lengths[slot];
+    todo text = {
+        length, (char *) arena_get(&list->arena, list->offsets[slot]), 0, length
+    };
+
+    return text;
+}
+
+int list_done(const struct todo_list *list, int at) {
+    return list_bit(list, list_slot(list, at));
+}
+
+int list_id(const struct todo_list *list, int at) {
+    return list->ids[list_slot(list, at)];
+}
+
+int list_insert(struct todo_list *list, int at, const char *string, int length,
+    int done) {
+    if (list->gap_start == list->gap_end) {
+        list_grow(list, list->capacity < 16 ? 16 : list->capacity * 2);
+
+        if (list->gap_start == list->gap_end) return -1;
+    }
+
+    uint32_t offset = arena_store(&list->arena, string, length);
+    if (offset == ARENA_NONE) return -1;
+
+    int id = list_new_id(list);
+    if (id == -1) return -1;
+
+    list_move_gap(list, at);
+
+    int slot = list->gap_start++;
+
+    list->offsets[slot] = offset;
+    list->lengths[slot] = length;
+    list->ids[slot] = id;
+    list->slots[id] = slot;
+
+    if (done) list_set_done(list, at, 1);
+
+    return 0;
+}
+
+int list_append(struct todo_list *list, const uint32_t *offsets,
+    const uint32_t *lengths, const unsigned char *done, int count) {
+    int at = list_count(list);
+
+    if (list->gap_end - list->gap_start < count) {
+        int capacity = list->capacity * 2;
+
+        if (capacity < at + count) capacity = at + count;
+
+        list_grow(list, capacity);
+
+        if (list->gap_end - list->gap_start < count) return -1;
+    }
+
+    list_move_gap(list, at);
+
+    int start = list->gap_start;
+
+    memcpy(&list->offsets[start], offsets, sizeof(uint32_t) * count);
+    memcpy(&list->lengths[start], lengths, sizeof(uint32_t) * count);
+
+    int word = start / LIST_WORD_BITS;
+    int delta = 0;
+
+    for (int i = 0; i < count; i++) {
+        int slot = start + i;
+        int id = list_new_id(list);
+
+        if (id == -1) return -1;
+
+        list->ids[slot] = id;
+        list->slots[id] = slot;
+        list->gap_start++;
+
+        if (slot / LIST_WORD_BITS != word) {
+            if (delta) list_tree_add(list, word, delta);
+            word = slot / LIST_WORD_BITS;
+            delta = 0;
+        }
+
+        if (done[i]) {
+            list_flip(list, slot);
+            delta++;
+        }
+    }
+
+    if (delta) list_tree_add(list, word, delta);
+
+    return 0;
+}
+
+int list_set_text(struct todo_list *list, int at, const char *string, int length) {
+    uint32_t offset = arena_store(&list->arena, string, length);
+    if (offset == ARENA_NONE) return -1;
+
+    int slot = list_slot(list, at);
+
+    arena_release(&list->arena, list->offsets[slot], list->lengths[slot]);
+    list->offsets[slot] = offset;
+    list->lengths[slot] = length;
+
+    return 0;
+}
+
+void list_remove(struct todo_list *list, int at) {
+    list_set_done(list, at, 0);
+    list_move_gap(list, at);
+
+    int slot = list->gap_end++;
+
+    arena_release(&list->arena, list->offsets[slot], list->lengths[slot]);
+    list_free_id(list, list->ids[slot]);
+}
+
+int list_compact(struct todo_list *list) {
+    struct arena compact = ARENA_INIT;
+
+    if (arena_map(&compact, list->arena.base, list->arena.base_length) == -1 ||
+        arena_reserve(&compact, list->arena.live) == -1) return -1;
+
+    arena_bulk(&compact, 1);
+
+    for (int slot = 0; slot < list->capacity; slot++) {
+        if (slot == list->gap_start) slot = list->gap_end;
+        if (slot == list->capacity) break;
+
+        list->offsets[slot] = arena_store(&compact,
+            arena_get(&list->arena, list->offsets[slot]), list->lengths[slot]);
+    }
+
+    arena_bulk(&compact, list->arena.bulk);
+    arena_free(&list->arena);
+    list->arena = compact;
+
+    return 0;
+}
+
+void list_set_done(struct todo_list *list, int at, int done) {
+    int slot = list_slot(list, at);
+
+    if (list_bit(list, slot) == (done != 0)) return;
+
+    list_flip(list, slot);
+    list_tree_add(list, slot / LIST_WORD_BITS, done ? 1 : -1);
+}
+
+int list_rank(const struct todo_list *list, int at, int done) {
+    int slot = list_slot(list, at);
+    int word = slot / LIST_WORD_BITS;
+    int count = 0;
+
+    if (slot % LIST_WORD_BITS) {
+        count = __builtin_popcountll(list->done[word] &
+            list_range_bits(word, 0, slot));
+    }
+
+    for (; word > 0; word -= word & -word) {
+        count += list->tree[word];
+    }
+
+    return done ? count : at - count;
+}
+
+int list_select(const struct todo_list *list, int rank, int done) {
+    int words = list_words(list->capacity);
+    int word = 0;
+    int step = 1;
+
+    while (step * 2 <= words) step *= 2;
+
+    for (; step; step /= 2) {
+        int next = word + step;
+
+        if (next > words) continue;
+
+        int count = list->tree[next];
+
+        if (!done) {
+            int end = next * LIST_WORD_BITS;
+            if (end > list->capacity) end = list->capacity;
+
+            count = list_occupied(list, end) -
+                list_occupied(list, word * LIST_WORD_BITS) - count;
+        }
+
+        if (count <= rank) {
+            word = next;
+            rank -= count;
+        }
+    }
+
+    uint64_t bits = done ? list->done[word] : list_open_bits(list, word);
+
+    while (rank--) bits &= bits - 1;
+
+    return list_occupied(list, word * LIST_WORD_BITS + __builtin_ctzll(bits));
+}
+
+void list_free(struct todo_list *list) {
+    free(list->offsets);
+    free(list->lengths);
+    free(list->ids);
+    free(list->done);
+    free(list->tree);
+    free(list->slots);
+    free(list->free_ids);
+    arena_free(&list->arena);
+    *list = (struct todo_list) LIST_INIT;
+}
@@ -0,0 +1,325 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "loader.h"
+#include "todo.h"
+
+int loader_thread_count(size_t length) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = length / LOADER_CHUNK_SIZE + 1;
+
+    if (cores < 1) cores = 1;
+    if (threads > (size_t) cores) threads = cores;
+    if (threads > LOADER_MAX_THREADS) threads = LOADER_MAX_THREADS;
+
+    return threads;
+}
+
+void loader_init(struct loader *loader, const char *base, size_t length,
+    int chunks) {
+    loader->base = base;
+    loader->buffer = NULL;
+    loader->length = length;
+    loader->file = -1;
+    loader->threads = 0;
+    loader->started = 0;
+    loader->chunk_count = 0;
+    loader->next = 0;
+    loader->notify = -1;
+    loader->chunks = calloc(chunks + 1, sizeof(struct loader_chunk));
+}
+
+int loader_open(struct loader *loader, int file, size_t length) {
+    char *buffer = malloc(length + 1);
+
+    loader_init(loader, NULL, length, length / LOADER_CHUNK_SIZE + 1);
+
+    loader->base = buffer;
+    loader->buffer = buffer;
+    loader->threads = loader_thread_count(length);
+    loader->file = dup(file);
+
+    if (buffer == NULL || loader->chunks == NULL || loader->file == -1) {
+        int saved = errno;
+        if (loader->file != -1) close(loader->file);
+        free(loader->chunks);
+        free(buffer);
+        errno = saved;
+        return -1;
+    }
+
+    for (size_t start = 0; start < length; start += LOADER_CHUNK_SIZE) {
+        struct loader_chunk *chunk = &loader->chunks[loader->chunk_count++];
+        size_t end = length - start > LOADER_CHUNK_SIZE ?
+            start + LOADER_CHUNK_SIZE : length;
+
+        chunk->start = &buffer[start];
+        chunk->end = &buffer[end];
+    }
+
+    return 0;
+}
+
+int loader_attach(struct loader *loader, const char *base, size_t length,
+    const uint32_t *offsets, const uint32_t *lengths, const unsigned char *done,
+    int count) {
+    loader_init(loader, base, length, count / LOADER_CHUNK_ITEMS + 1);
+
+    if (loader->chunks == NULL) return -1;
+
+    for (int first = 0; first < count; first += LOADER_CHUNK_ITEMS) {
+        struct loader_chunk *chunk = &loader->chunks[loader->chunk_count++];
+        int items = count - first < LOADER_CHUNK_ITEMS ?
+            count - first : LOADER_CHUNK_ITEMS;
+
+        chunk->start = base + (size_t) length * first / count;
+        chunk->offsets = (uint32_t *) &offsets[first];
+        chunk->lengths = (uint32_t *) &lengths[first];
+        chunk->done = (unsigned char *) &done[first];
+        chunk->count = items;
+        chunk->read = LOADER_READ;
+        chunk->parsed = 1;
+        chunk->borrowed = 1;
+    }
+
+    loader->next = loader->chunk_count;
+
+    return 0;
+}
+
+int loader_read(struct loader *loader, int index) {
+    struct loader_chunk *chunk = &loader->chunks[index];
+
+    pthread_mutex_lock(&loader->lock);
+
+    while (chunk->read == LOADER_READING) {
+        pthread_cond_wait(&loader->progress, &loader->lock);
+    }
+
+    if (chunk->read == LOADER_UNREAD) {
+        size_t offset = chunk->start - loader->base;
+        size_t size = chunk->end - chunk->start;
+        size_t total = 0;
+
+        chunk->read = LOADER_READING;
+        pthread_mutex_unlock(&loader->lock);
+
+        while (total < size) {
+            ssize_t n = pread(loader->file, &loader->buffer[offset + total],
+                size - total, offset + total);
+
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) break;
+
+            total += n;
+        }
+
+        pthread_mutex_lock(&loader->lock);
+        chunk->read = total == size ? LOADER_READ : LOADER_FAILED;
+        pthread_cond_broadcast(&loader->progress);
+    }
+
+    int result = chunk->read == LOADER_READ ? 0 : -1;
+
+    pthread_mutex_unlock(&loader->lock);
+
+    return result;
+}
+
+const char *loader_eol(struct loader *loader, int index, const char *line) {
+    while (index < loader->chunk_count) {
+        const char *end = loader->chunks[index].end;
+
+        if (line < end) {
+            const char *eol = memchr(line, '\n', end - line);
+            if (eol) return eol;
+            line = end;
+        }
+
+        if (++index < loader->chunk_count && loader_read(loader, index) == -1) {
+            return NULL;
+        }
+    }
+
+    return loader->base + loader->length;
+}
+
+int loader_push(struct loader_chunk *chunk, uint32_t offset, uint32_t length,
+    int done) {
+    if (chunk->count == chunk->capacity) {
+        int capacity = chunk->capacity ? chunk->capacity * 2 : LOADER_MIN_LINES;
+        uint32_t *offsets = realloc(chunk->offsets, sizeof(uint32_t) * capacity);
+        if (offsets) chunk->offsets = offsets;
+        uint32_t *lengths = realloc(chunk->lengths, sizeof(uint32_t) * capacity);
+        if (lengths) chunk->lengths = lengths;
+        unsigned char *flags = realloc(chunk->done, capacity);
+        if (flags) chunk->done = flags;
+
+        if (!offsets || !lengths || !flags) return -1;
+
+        chunk->capacity = capacity;
+    }
+
+    chunk->offsets[chunk->count] = offset;
+    chunk->lengths[chunk->count] = length;
+    chunk->done[chunk->count] = done;
+    chunk->count++;
+    chunk->done_count += done;
+
+    return 0;
+}
+
+int loader_parse_chunk(struct loader *loader, int index) {
+    struct loader_chunk *chunk = &loader->chunks[index];
+    const char *line = chunk->start;
+
+    if (loader_read(loader, index) == -1) return -1;
+
+    if (index > 0) {
+        if (loader_read(loader, index - 1) == -1) return -1;
+
+        if (line[-1] != '\n') {
+            line = loader_eol(loader, index, line);
+            if (line == NULL) return -1;
+            line++;
+        }
+    }
+
+    while (line < chunk->end) {
+        const char *eol = loader_eol(loader, index, line);
+
+        if (eol == NULL) return -1;
+
+        size_t line_length = eol - line;
+
+        while (line_length > 0 &&
+            (line[line_length - 1] == '\n' || line[line_length - 1] == '\r')) {
+                line_length--;
+            }
+
+        if (is_todo_line(line, line_length) &&
+            loader_push(chunk, &line[2] - loader->base, line_length - 2,
+                line[0] == '-') == -1) return -1;
+
+        line = eol + 1;
+    }
+
+    return 0;
+}
+
+void *loader_run(void *data) {
+    struct loader *loader = data;
+    int chunk;
+
+    while ((chunk = __atomic_fetch_add(&loader->next, 1, __ATOMIC_RELAXED)) <
+        loader->chunk_count) {
+        int result = loader_parse_chunk(loader, chunk);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->chunks[chunk].parsed = result == -1 ? -1 : 1;
+        pthread_cond_broadcast(&loader->progress);
+        pthread_mutex_unlock(&loader->lock);
+
+        if (loader->notify != -1 && write(loader->notify, "l", 1) == -1) {}
+    }
+
+    return NULL;
+}
+
+void loader_start(struct loader *loader, int notify) {
+    loader->notify = notify;
+
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->progress, NULL);
+
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+
+    while (loader->started < loader->threads &&
+        pthread_create(&loader->workers[loader->started], NULL, loader_run,
+            loader) == 0) {
+        loader->started++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (loader->started == 0) loader_run(loader);
+}
+
+int loader_ready(struct loader *loader, int chunk) {
+    pthread_mutex_lock(&loader->lock);
+
+    int parsed = loader->chunks[chunk].parsed;
+
+    pthread_mutex_unlock(&loader->lock);
+
+    return parsed != 0;
+}
+
+int loader_wait(struct loader *loader, int chunk) {
+    pthread_mutex_lock(&loader->lock);
+
+    while (!loader->chunks[chunk].parsed) {
+        pthread_cond_wait(&loader->progress, &loader->lock);
+    }
+
+    int parsed = loader->chunks[chunk].parsed;
+
+    pthread_mutex_unlock(&loader->lock);
+
+    return parsed == -1 ? -1 : 0;
+}
+
+int loader_append(struct loader_chunk *chunk, struct todo_list *list) {
+    int result = list_append(list, chunk->offsets, chunk->lengths, chunk->done,
+        chunk->count);
+
+    if (chunk->borrowed) {
+        for (int i = 0; i < chunk->count; i++) chunk->done_count += chunk->done[i];
+
+        chunk->offsets = NULL;
+        chunk->lengths = NULL;
+        chunk->done = NULL;
+
+        return result;
+    }
+
+    free(chunk->offsets);
+    free(chunk->lengths);
+    free(chunk->done);
+    chunk->offsets = NULL;
+    chunk->lengths = NULL;
+    chunk->done = NULL;
+
+    return result;
+}
+
+void loader_finish(struct loader *loader) {
+    while (loader->started > 0) {
+        pthread_join(loader->workers[--loader->started], NULL);
+    }
+
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->progress);
+
+    for (int i = 0; i < loader->chunk_count; i++) {
+        if (loader->chunks[i].borrowed) continue;
+
+        free(loader->chunks[i].offsets);
+        free(loader->chunks[i].lengths);
+        free(loader->chunks[i].done);
+    }
+
+    if (loader->file != -1) close(loader->file);
+
+    free(loader->chunks);
+    loader->file = -1;
+    loader->chunks = NULL;
+    loader->chunk_count = 0;
+}
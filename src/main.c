@@ -2,717 +2,601 @@
 #define _BSD_SOURCE
 #define _GNU_SOURCE
 
-#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
-#include <stdarg.h>
-#include <time.h>
 
+#include "app.h"
 #include "terminal.h"
 #include "support.h"
-#include "buffer.h"
-#include "todo.h"
-
-#define TODO_VERSION "0.0.1"
-#define TODO_OFFSET 6
-#define ctrl_key(k) ((k) & 0x1f)
-
-enum keys {
-    TAB_KEY = 9,
-    BACKSPACE = 127,
-    ARROW_LEFT = 1000,
-    ARROW_RIGHT,
-    ARROW_UP,
-    ARROW_DOWN,
-    DEL_KEY,
-    HOME_KEY,
-    END_KEY,
-    PAGE_UP,
-    PAGE_DOWN,
-    ALT_ENTER,
-    SHIFT_TAB
-};
-
-enum work_modes {
-    WM_NORMAL,
-    WM_INSERT
-};
-
-enum insertion_modes {
-    IM_AFTER,
-    IM_BEFORE,
-    IM_CURRENT
-};
-
-struct cursor_state {
-    int x;
-    int y;
-};
-
-struct todos_stats {
-    int count;
-    int done;
-    int todo;
-};
-
-struct config_state {
-    struct cursor_state cursor;
-    struct todos_stats stats;
-    int row_offset;
-    int screen_rows;
-    int screen_cols;
-    int work_mode;
-    int insertion_mode;
-    char status_message[80];
-    time_t status_message_time;
-    todo *todos;
-    char *filename;
-};
-
-struct config_state state;
-
-void set_status_message(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    vsnprintf(state.status_message, sizeof(state.status_message), fmt, ap);
-    va_end(ap);
-    state.status_message_time = time(NULL);
-}
+#include "export.h"
 
-char *todos_to_string(int *buffer_length) {
-    int total_length = 0;
-    int i;
+char *get_default_filename() {
+    char *home_dir = getenv("HOME");
 
-    for (i = 0; i < state.stats.count; i++) {
-        total_length += state.todos[i].size + 3;
-    }
+    if (home_dir) {
+        char *default_filename = "/.todos.txt";
 
-    *buffer_length = total_length;
+        int home_dir_length = strlen(home_dir);
+        int default_filename_length = strlen(default_filename);
+        int length = home_dir_length + default_filename_length + 1;
 
-    char *buffer = malloc(total_length);
-    char *p = buffer;
+        char *filename = malloc(length);
 
-    for (i = 0; i < state.stats.count; i++) {
-        *p = state.todos[i].done ? '-' : ' ';
-        p++;
-        *p = ' ';
-        p++;
-        memcpy(p, state.todos[i].string, state.todos[i].size);
-        p += state.todos[i].size;
-        *p = '\n';
-        p++;
-    }
+        strcpy(filename, home_dir);
+        strcpy(&filename[home_dir_length], default_filename);
+        filename[length] = '\0';
 
-    return buffer;
+        return filename;
+    } else {
+        return NULL;
+    }
 }
 
-void when_save() {
-    if (state.filename == NULL) return;
+int parse_sync(const char *policy) {
+    if (strcmp(policy, "save") == 0) return WRITER_SYNC_SAVE;
+    if (strcmp(policy, "exit") == 0) return WRITER_SYNC_EXIT;
 
-    int length;
-    char *buffer = todos_to_string(&length);
+    char *end;
+    long interval = strtol(policy, &end, 10);
 
-    int file = open(state.filename, O_RDWR | O_CREAT, 0644);
+    if (end == policy || *end != '\0' || interval <= 0 || interval > INT_MAX) {
+        return -2;
+    }
 
-    if (file != -1) {
-        if (ftruncate(file, length) != 1) {
-            if (write(file, buffer, length) == length) {
-                close(file);
-                free(buffer);
-                set_status_message("%d bytes written to disk", length);
-                return;
-            }
-        }
+    return interval;
+}
+
+int batch_index(const char *arg, int *at) {
+    char *end;
+    long index = strtol(arg, &end, 10);
 
-        close(file);
+    if (end == arg || *end != '\0' || index < 1 || index > state.stats.count) {
+        return -1;
     }
 
-    free(buffer);
-    set_status_message("Can't save I/O error: %s", strerror(errno));
-}
+    *at = index - 1;
 
-void clear_screen() {
-    write(STDOUT_FILENO, "\x1b[2J", 4);
-    write(STDOUT_FILENO, "\x1b[H", 3);
-    write(STDOUT_FILENO, "\x1b[?25h", 6);
+    return 0;
 }
 
-int read_key() {
-    int nread;
-    char c;
+void batch_list() {
+    for (int i = 0; i < state.stats.count; i++) {
+        todo text = list_text(&state.todos, i);
 
-    while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
-        if (nread == -1 && errno != EAGAIN)
-            die("read");
+        printf("%d\t%c %.*s\n", i + 1, list_done(&state.todos, i) ? '-' : ' ',
+            text.size, text.string);
     }
+}
 
-    if (c == '\x1b') {
-        char seq[3];
+int batch_known(const char *command) {
+    return strcmp(command, "add") == 0 || strcmp(command, "done") == 0 ||
+        strcmp(command, "rm") == 0 || strcmp(command, "ls") == 0 ||
+        strcmp(command, "apply") == 0;
+}
 
-        if (read(STDIN_FILENO, &seq[0], 1) != 1) return '\x1b';
+int batch_op(const char *command, const char *arg, int length, int *changed) {
+    int at;
 
-        if (seq[0] == '\r') {
-            return ALT_ENTER;
-        }
+    if (strcmp(command, "add") == 0) {
+        if (length == 0 || memchr(arg, '\n', length) != NULL) return -1;
 
-        if (read(STDIN_FILENO, &seq[1], 1) != 1) return '\x1b';
-
-        if (seq[0] == '[') {
-            if (seq[1] >= '0' && seq[1] <= '9') {
-                if (read(STDIN_FILENO, &seq[2], 1) != 1) return '\x1b';
-                if (seq[2] == '~') {
-                    switch (seq[1]) {
-                        case '1': return HOME_KEY;
-                        case '3': return DEL_KEY;
-                        case '4': return END_KEY;
-                        case '5': return PAGE_UP;
-                        case '6': return PAGE_DOWN;
-                        case '7': return HOME_KEY;
-                        case '8': return END_KEY;
-                    }
-                }
-            } else {
-                switch (seq[1]) {
-                    case 'A': return ARROW_UP;
-                    case 'B': return ARROW_DOWN;
-                    case 'C': return ARROW_RIGHT;
-                    case 'D': return ARROW_LEFT;
-                    case 'H': return HOME_KEY;
-                    case 'F': return END_KEY;
-                    case 'Z': return SHIFT_TAB;
-                }
-            }
-        } else if (seq[0] == 'O') {
-            switch (seq[1]) {
-                case 'H': return HOME_KEY;
-                case 'F': return END_KEY;
-            }
+        push_todo(state.stats.count, arg, length, 0);
+        *changed = 1;
+    } else if (strcmp(command, "done") == 0) {
+        if (batch_index(arg, &at) == -1) return -1;
+
+        if (!list_done(&state.todos, at)) {
+            toggle_todo(at);
+            *changed = 1;
         }
+    } else if (strcmp(command, "rm") == 0) {
+        if (batch_index(arg, &at) == -1) return -1;
 
-        return '\x1b';
+        remove_todo(at);
+        *changed = 1;
+    } else if (strcmp(command, "ls") == 0) {
+        if (length != 0) return -1;
+
+        batch_list();
     } else {
-        return c;
+        return -1;
     }
-}
-
-void move_cursor(int key) {
-    todo *current = (state.cursor.y >= state.stats.count) ?
-                    NULL : &state.todos[state.cursor.y];
 
-    switch (key) {
-        case ARROW_LEFT:
-            if (state.cursor.x > TODO_OFFSET &&
-                state.work_mode == WM_INSERT)
-                state.cursor.x--;
-            break;
-        case ARROW_RIGHT:
-            if (current && state.work_mode == WM_INSERT &&
-                state.cursor.x < current->size + TODO_OFFSET)
-                state.cursor.x++;
-            break;
-        case SHIFT_TAB:
-        case ARROW_UP:
-            if (state.cursor.y != 0 && state.work_mode == WM_NORMAL)
-                state.cursor.y--;
-            break;
-        case TAB_KEY:
-        case ARROW_DOWN:
-            if (state.cursor.y < state.stats.count - 1 &&
-                state.work_mode == WM_NORMAL)
-                state.cursor.y++;
-            break;
-    }
+    return 0;
 }
 
-void begin_insert_mode() {
-    state.work_mode = WM_INSERT;
-}
+int batch_apply(int *changed) {
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int number = 0;
 
-void end_insert_mode() {
-    state.work_mode = WM_NORMAL;
-}
+    while ((length = getline(&line, &capacity, stdin)) != -1) {
+        number++;
 
-void todo_del_char(todo *src, int at) {
-    if (at < 0 || at >= src->size) return;
-    memmove(&src->string[at], &src->string[at + 1], src->size - at);
-    src->size--;
-}
+        if (length > 0 && line[length - 1] == '\n') line[--length] = '\0';
+        if (length == 0) continue;
 
-void del_char() {
-    if (state.cursor.y == state.stats.count) return;
+        char *arg = memchr(line, ' ', length);
+        int arg_length = 0;
 
-    todo *current = &state.todos[state.cursor.y];
+        if (arg != NULL) {
+            *arg++ = '\0';
+            arg_length = length - (arg - line);
+        } else {
+            arg = &line[length];
+        }
 
-    if (state.cursor.x > TODO_OFFSET) {
-        todo_del_char(current, state.cursor.x - TODO_OFFSET - 1);
-        state.cursor.x--;
+        if (strcmp(line, "apply") == 0 ||
+            batch_op(line, arg, arg_length, changed) == -1) {
+            fprintf(stderr, "todo: line %d: invalid operation\n", number);
+            free(line);
+            return -1;
+        }
     }
-}
 
-void todo_insert_char(todo *dest, int at, int c) {
-    if (at < 0 || at > dest->size) at = dest->size;
-    dest->string = realloc(dest->string, dest->size + 2);
-    memmove(&dest->string[at + 1], &dest->string[at], dest->size - at + 1);
-    dest->size++;
-    dest->string[at] = c;
-}
+    free(line);
 
-void insert_char(int c) {
-    todo_insert_char(&state.todos[state.cursor.y], state.cursor.x - TODO_OFFSET, c);
-    state.cursor.x++;
+    return 0;
 }
 
-void push_todo(int at, char *string, size_t length, int done) {
-    if (at < 0 || at > state.stats.count) return;
+int batch_run(int argc, char *argv[]) {
+    int changed = 0;
+    int result;
 
-    state.todos = realloc(state.todos, sizeof(todo) * (state.stats.count + 1));
-    memmove(&state.todos[at + 1], &state.todos[at], sizeof(todo) * (state.stats.count - at));
+    if (strcmp(argv[0], "apply") == 0) {
+        if (argc != 2 || strcmp(argv[1], "-") != 0) return -1;
 
-    state.todos[at].done = done;
-    state.todos[at].size = length;
-    state.todos[at].string = malloc(length + 1);
-    memcpy(state.todos[at].string, string, length);
-    state.todos[at].string[length] = '\0';
+        if (batch_apply(&changed) == -1) return 1;
+    } else {
+        struct buffer arg = BUFFER_INIT;
 
-    state.stats.count++;
+        for (int i = 1; i < argc; i++) {
+            if (i > 1) buffer_append_char(&arg, ' ');
+            buffer_append(&arg, argv[i], strlen(argv[i]));
+        }
 
-    if (done) {
-        state.stats.done++;
-    } else {
-        state.stats.todo++;
+        buffer_append_char(&arg, '\0');
+        result = batch_op(argv[0], arg.string, arg.length - 1, &changed);
+        buffer_free(&arg);
+
+        if (result == -1) {
+            fprintf(stderr, "todo: %s: invalid arguments\n", argv[0]);
+            return 1;
+        }
     }
-}
 
-void toggle_todo() {
-    int *done = &state.todos[state.cursor.y].done;
-    *done = *done == 0 ? 1 : 0;
+    if (fflush(stdout) == EOF) return 1;
+    if (!changed) return 0;
 
-    if (*done) {
-        state.stats.done++;
-        state.stats.todo--;
-    } else {
-        state.stats.done--;
-        state.stats.todo++;
+    char message[80];
+
+    when_save();
+    writer_flush(&state.writer);
+
+    if (writer_error(&state.writer, message, sizeof(message))) {
+        fprintf(stderr, "todo: %s\n", message);
+        return 1;
     }
-}
 
-void free_todo(todo *src) {
-    free(src->string);
+    return 0;
 }
 
-void create_todo() {
-    int at = state.insertion_mode == IM_AFTER ?
-        state.cursor.y + 1 : state.cursor.y;
+int serve_apply(struct protocol_message *message, const char *payload) {
+    uint32_t count = state.stats.count;
+    int at = message->at;
+    int length = message->length;
+    int done = message->done != 0;
 
-    if (at > state.stats.count) {
-        at = state.stats.count;
-    }
+    if (message->version != state.serve.version) return -1;
 
-    push_todo(at, "", 0, 0);
+    switch (message->type) {
+        case PROTOCOL_INSERT:
+            if (message->at > count) return -1;
 
-    if (state.insertion_mode == IM_AFTER) {
-        if (state.stats.count > state.cursor.y + 1) {
-            state.cursor.y++;
-        }
-    }
+            push_todo(at, payload, length, done);
+            when_journal(journal_insert(&state.journal, at, done, payload, length));
+            break;
+        case PROTOCOL_DELETE:
+            if (message->at >= count) return -1;
 
-    state.cursor.x = TODO_OFFSET;
-}
+            remove_todo(at);
+            when_journal(journal_delete(&state.journal, at));
+            break;
+        case PROTOCOL_TOGGLE:
+            if (message->at >= count) return -1;
+
+            toggle_todo(at);
+            when_journal(journal_toggle(&state.journal, at));
+            break;
+        case PROTOCOL_EDIT:
+            if (message->at >= count) return -1;
+
+            set_todo_text(at, payload, length);
+            when_journal(journal_edit(&state.journal, at, payload, length));
+            break;
+    }
 
-void remove_todo(int at) {
-    if (at < 0 || at >= state.stats.count) return;
+    message->version = ++state.serve.version;
 
-    int done = state.todos[at].done;
+    return 0;
+}
 
-    free_todo(&state.todos[at]);
-    memmove(&state.todos[at], &state.todos[at + 1],
-        sizeof(todo) * (state.stats.count - at - 1));
+void serve_items(struct protocol_stream *stream, uint32_t at, uint32_t count) {
+    struct buffer items = BUFFER_INIT;
+    struct protocol_message message = {
+        PROTOCOL_ITEMS, state.serve.version, at, state.stats.count, 0, 0
+    };
 
-    state.stats.count--;
+    if (count > LOADER_CHUNK_ITEMS) count = LOADER_CHUNK_ITEMS;
 
-    if (done) {
-        state.stats.done--;
-    } else {
-        state.stats.todo--;
+    for (uint32_t i = at; i < at + count && i < (uint32_t) state.stats.count; i++) {
+        todo text = list_text(&state.todos, i);
+        protocol_item(&items, text.string, text.size, list_done(&state.todos, i));
     }
-}
 
-void edit_todo() {
-    state.insertion_mode = IM_CURRENT;
-    state.cursor.x = state.todos[state.cursor.y].size + TODO_OFFSET;
+    message.length = items.length;
+    protocol_send(stream, &message, items.string);
+    buffer_free(&items);
 }
 
-void normal_keys(int c) {
-    switch (c) {
-        case '\r':
-            state.insertion_mode = IM_AFTER;
-            create_todo();
-            begin_insert_mode();
-            break;
+void serve_error(struct server_client *client, const char *error) {
+    struct protocol_message reply = { PROTOCOL_ERROR, 0, 0, 0, 0, strlen(error) };
 
-        case ALT_ENTER:
-            state.insertion_mode = IM_BEFORE;
-            create_todo();
-            begin_insert_mode();
-            break;
+    protocol_send(&client->stream, &reply, error);
+}
 
-        case ctrl_key('q'):
-            clear_screen();
-            exit(0);
-            break;
+void serve_stale(struct server_client *client) {
+    struct protocol_message reply = {
+        PROTOCOL_STALE, state.serve.version, 0, 0, 0, 0
+    };
 
-        case 'e':
-            edit_todo();
-            begin_insert_mode();
-            break;
+    client->stale = 1;
+    client->lagging = 0;
+    protocol_send(&client->stream, &reply, NULL);
+}
 
-        case ' ':
-            toggle_todo();
-            when_save();
-            break;
+void serve_merge() {
+    struct server *server = &state.serve.server;
+    int changed = when_changed();
 
-        case HOME_KEY:
-            state.cursor.y = 0;
-            break;
-        case END_KEY:
-            state.cursor.y = state.stats.count - 1;
-            break;
+    if (state.status_message[0] != '\0') {
+        fprintf(stderr, "todo: %s\n", state.status_message);
+        state.status_message[0] = '\0';
+    }
 
-        case DEL_KEY:
-        case BACKSPACE:
-            if (c == BACKSPACE) move_cursor(ARROW_UP);
-            remove_todo(state.cursor.y);
-            when_save();
-            break;
+    if (!changed) return;
 
-        case PAGE_DOWN:
-        case PAGE_UP:
-            {
-                int times = state.screen_rows / 2;
-                while (times--)
-                    move_cursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
-            }
-            break;
+    state.serve.version++;
 
-        case ARROW_DOWN:
-        case ARROW_LEFT:
-        case ARROW_RIGHT:
-        case ARROW_UP:
-        case TAB_KEY:
-        case SHIFT_TAB:
-            move_cursor(c);
-            break;
-    }
+    for (int i = 0; i < server->count; i++) serve_stale(&server->clients[i]);
 }
 
-void insert_keys(int c) {
-    switch (c) {
-        case '\x1b':
-        case '\r':
-            end_insert_mode();
-            if (state.todos[state.cursor.y].size == 0) {
-                remove_todo(state.cursor.y);
-                if (state.insertion_mode == IM_AFTER) {
-                    move_cursor(ARROW_UP);
-                }
-            } else {
-                when_save();
-            }
-            break;
+void serve_message(int index, struct protocol_message *message, const char *payload) {
+    struct server_client *client = &state.serve.server.clients[index];
+    struct protocol_message reply = { PROTOCOL_STATE, 0, 0, 0, 0, 0 };
+    char *path;
 
-        case TAB_KEY:
-            if (state.todos[state.cursor.y].size != 0) {
-                state.insertion_mode = IM_AFTER;
-                create_todo();
-                begin_insert_mode();
-            }
-            break;
+    switch (message->type) {
+        case PROTOCOL_OPEN:
+            path = strndup(payload, message->length);
 
-        case SHIFT_TAB:
-            if (state.todos[state.cursor.y].size != 0) {
-                state.insertion_mode = IM_BEFORE;
-                create_todo();
-                begin_insert_mode();
+            if (path == NULL || strcmp(path, state.serve.path) != 0) {
+                serve_error(client, "not serving this file");
+            } else {
+                reply.version = state.serve.version;
+                reply.count = state.stats.count;
+                client->stale = 0;
+                protocol_send(&client->stream, &reply, NULL);
             }
-            break;
 
-        case PAGE_DOWN:
-        case PAGE_UP:
-        case ctrl_key('l'):
-        case ALT_ENTER:
+            free(path);
             break;
-
-        case HOME_KEY:
-            state.cursor.x = TODO_OFFSET;
-            break;
-        case END_KEY:
-            if (state.cursor.y < state.stats.count) {
-                state.cursor.x = state.todos[state.cursor.y].size + TODO_OFFSET;
-            }
+        case PROTOCOL_SUBSCRIBE:
+            client->subscribed = 1;
             break;
-
-        case BACKSPACE:
-        case ctrl_key('h'):
-        case DEL_KEY:
-            if (c == DEL_KEY) move_cursor(ARROW_RIGHT);
-            del_char();
+        case PROTOCOL_RANGE:
+            serve_items(&client->stream, message->at, message->count);
             break;
-
-        case ARROW_DOWN:
-        case ARROW_LEFT:
-        case ARROW_RIGHT:
-        case ARROW_UP:
-            move_cursor(c);
+        case PROTOCOL_INSERT:
+        case PROTOCOL_DELETE:
+        case PROTOCOL_TOGGLE:
+        case PROTOCOL_EDIT:
+            if (client->stale) break;
+
+            if ((message->type == PROTOCOL_INSERT || message->type == PROTOCOL_EDIT) &&
+                memchr(payload, '\n', message->length) != NULL) {
+                serve_error(client, "todo text can't contain a newline");
+            } else if (serve_apply(message, payload) == -1) {
+                serve_stale(client);
+            } else {
+                reply.type = PROTOCOL_ACK;
+                reply.version = message->version;
+                reply.count = state.stats.count;
+                protocol_send(&client->stream, &reply, NULL);
+                server_broadcast(&state.serve.server, index, message, payload);
+            }
             break;
-        default:
-            insert_char(c);
     }
 }
 
-void process_keys() {
-    int c = read_key();
+int serve_client(int index) {
+    struct protocol_stream *stream = &state.serve.server.clients[index].stream;
+    struct protocol_message message;
+    const char *payload;
+    int found;
 
-    if (state.work_mode == WM_NORMAL) {
-        normal_keys(c);
-    } else {
-        insert_keys(c);
+    if (protocol_read(stream) == -1) return -1;
+
+    while ((found = protocol_next(stream, &message, &payload)) == 1) {
+        serve_message(index, &message, payload);
     }
+
+    return found;
 }
 
-void scrolling() {
-    if (state.cursor.y < state.row_offset) {
-        state.row_offset = state.cursor.y;
-    }
+void on_serve_signal(int sig) {
+    int saved = errno;
 
-    if (state.cursor.y >= state.row_offset + state.screen_rows) {
-        state.row_offset = state.cursor.y - state.screen_rows + 1;
-    }
+    (void) sig;
+    write(state.wakeup[1], "q", 1);
+    errno = saved;
 }
 
-void render_todo(struct buffer *content, struct todo src, int index) {
-    buffer_append(content, "  ", 2);
+int serve() {
+    struct server *server = &state.serve.server;
+    struct pollfd *fds = NULL;
+    int running = 1;
 
-    char pointer = index != state.cursor.y ? ' ' :
-                    state.work_mode == WM_NORMAL ? '>' : '*';
+    state.serve.path = realpath(state.filename, NULL);
 
-    buffer_append(content, &pointer, 1);
-    buffer_append(content, " ", 1);
-    buffer_append(content, src.done ? " " : "-", 1);
-    buffer_append(content, " ", 1);
+    if (state.serve.path == NULL || server_open(server, state.filename) == -1) {
+        fprintf(stderr, "todo: can't serve %s: %s\n", state.filename, strerror(errno));
+        return 1;
+    }
 
-    int length = src.size;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_serve_signal;
+    sigemptyset(&action.sa_mask);
 
-    if (length + TODO_OFFSET > state.screen_cols)
-        length = state.screen_cols;
+    if (sigaction(SIGINT, &action, NULL) == -1 ||
+        sigaction(SIGTERM, &action, NULL) == -1) die("sigaction");
 
-    char *c = &src.string[0];
+    signal(SIGPIPE, SIG_IGN);
 
-    int i;
-    for (i = 0; i < length; i++) {
-        if (isprint(c[i]) && src.done) {
-            buffer_append(content, "\x1b[9m", 5);
-            buffer_append(content, "\x1b[35m", 5);
-            buffer_append(content, &c[i], 1);
-            buffer_append(content, "\x1b[30m", 5);
-            buffer_append(content, "\x1b[0m", 5);
-        } else {
-            buffer_append(content, &c[i], 1);
-        }
+    if (watch_open(&state.watch, state.filename) == -1) {
+        fprintf(stderr, "todo: can't watch %s: %s\n", state.filename, strerror(errno));
     }
-}
-
-void render(struct buffer *content) {
-    for (int i = 0; i < state.screen_rows; i++) {
-        int filerow = i + state.row_offset;
 
-        if (filerow >= state.stats.count) {
-            if (state.stats.count == 0 && i == 0) {
-                char welcome[80];
-                int welcome_length = snprintf(welcome, sizeof(welcome),
-                    "Todo App -- version %s", TODO_VERSION);
+    state.merge.pending = 1;
 
-                if (welcome_length > state.screen_cols)
-                    welcome_length = state.screen_cols;
+    while (running) {
+        int polled = server->count;
 
-                int padding = (state.screen_cols - welcome_length) / 2;
+        fds = realloc(fds, sizeof(struct pollfd) * (polled + 3));
+        if (fds == NULL) die("realloc");
 
-                if (padding) {
-                    buffer_append(content, "~", 1);
-                    padding--;
-                }
+        fds[0] = (struct pollfd) { state.wakeup[0], POLLIN, 0 };
+        server_events(server, &fds[1]);
+        fds[polled + 2] = (struct pollfd) { state.watch.fd, POLLIN, 0 };
 
-                while (padding--) buffer_append(content, " ", 1);
+        if (state.merge.pending) serve_merge();
 
-                buffer_append(content, welcome, welcome_length);
-            } else {
-                buffer_append(content, "~", 1);
-            }
-        } else {
-            render_todo(content, state.todos[filerow], filerow);
+        if (poll(fds, polled + 3, state.merge.pending ? 0 : -1) == -1) {
+            if (errno == EINTR) continue;
+            die("poll");
         }
 
-        buffer_append(content, "\x1b[K", 3);
-        buffer_append(content, "\r\n", 2);
-    }
-}
+        if (fds[0].revents & POLLIN) {
+            char events[64];
+            ssize_t n;
 
-void get_stats(int *done, int *todo) {
-    int i;
+            while ((n = read(state.wakeup[0], events, sizeof(events))) > 0) {
+                for (ssize_t i = 0; i < n; i++) {
+                    char message[80];
 
-    for (i = 0; i < state.stats.count; i++) {
-        if (state.todos[i].done) {
-            (*done)++;
-        } else {
-            (*todo)++;
+                    if (events[i] == 'q') running = 0;
+
+                    if (events[i] == 's' &&
+                        writer_error(&state.writer, message, sizeof(message))) {
+                        fprintf(stderr, "todo: %s\n", message);
+                    }
+                }
+            }
         }
-    }
-}
 
-void render_status_bar(struct buffer *dest) {
-    buffer_append(dest, "\x1b[7m", 4);
+        for (int i = polled - 1; i >= 0; i--) {
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR) &&
+                serve_client(i) == -1) server_drop(server, i);
+        }
 
-    int done = 0;
-    int todo = 0;
+        if (fds[1].revents & POLLIN && server_accept(server) == -1) {
+            fprintf(stderr, "todo: accept: %s\n", strerror(errno));
+        }
 
-    get_stats(&done, &todo);
+        if (fds[polled + 2].revents & POLLIN && watch_changed(&state.watch)) {
+            state.merge.pending = 1;
+        }
 
-    char status[80];
-    int length = snprintf(status, sizeof(status), "%2d - %2d/%2d/%2d",
-        state.cursor.y + 1, state.stats.todo, state.stats.done, state.stats.count);
+        for (int i = server->count - 1; i >= 0; i--) {
+            struct server_client *client = &server->clients[i];
 
-    if (length > state.screen_cols) length = state.screen_cols;
+            if (client->stream.out.length && protocol_write(&client->stream) == -1) {
+                server_drop(server, i);
+            } else if (client->lagging && client->stream.out.length == 0) {
+                serve_stale(client);
+            }
+        }
+    }
 
-    buffer_append(dest, status, length);
+    free(fds);
+    server_close(server);
 
-    while (length < state.screen_cols) {
-        buffer_append(dest, " ", 1);
-        length++;
-    }
+    if (journal_dirty(&state.journal)) when_save();
+    writer_flush(&state.writer);
 
-    buffer_append(dest, "\x1b[m", 3);
-    buffer_append(dest, "\r\n", 2);
+    return 0;
 }
 
-void render_status_message(struct buffer *dest) {
-    buffer_append(dest, "\x1b[K", 3);
+int served(const char *filename) {
+    char *path = protocol_path(filename);
+    int fd = path ? protocol_connect(path) : -1;
 
-    int message_length = strlen(state.status_message);
+    free(path);
 
-    if (message_length > state.screen_cols)
-        message_length = state.screen_cols;
+    if (fd == -1) return 0;
 
-    if (message_length && time(NULL) - state.status_message_time < 5)
-        buffer_append(dest, state.status_message, message_length);
-}
+    close(fd);
 
-void refresh_screen() {
-    scrolling();
+    return 1;
+}
 
-    struct buffer content = BUFFER_INIT;
+void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-s save|exit|<ms>] [-t trace] [file]\n"
+        "       %s [-s save|exit|<ms>] [-t trace] [-f file] "
+        "add <text> | done <n> | rm <n> | ls | apply - | serve\n"
+        "       %s [-f file|-] export [-F text|json|csv] [-o|-d] [-m text]\n",
+        program, program, program);
+    exit(1);
+}
 
-    buffer_append(&content, "\x1b[?25l", 6);
-    buffer_append(&content, "\x1b[H", 3);
+int export_run(const char *filename, int argc, char *argv[], const char *program) {
+    struct export_options options = { EXPORT_TEXT, EXPORT_ALL, "", 0 };
+    int opt;
 
-    render(&content);
-    render_status_bar(&content);
-    render_status_message(&content);
+    optind = 0;
 
-    char buffer[32];
-    int y = (state.cursor.y - state.row_offset) + 1;
-    int x = state.cursor.x + 1;
+    while ((opt = getopt(argc, argv, "+F:odm:")) != -1) {
+        switch (opt) {
+            case 'F':
+                if (strcmp(optarg, "text") == 0) {
+                    options.format = EXPORT_TEXT;
+                } else if (strcmp(optarg, "json") == 0) {
+                    options.format = EXPORT_JSON;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    options.format = EXPORT_CSV;
+                } else {
+                    usage(program);
+                }
+                break;
+            case 'o':
+                options.filter = EXPORT_OPEN;
+                break;
+            case 'd':
+                options.filter = EXPORT_DONE;
+                break;
+            case 'm':
+                options.query = optarg;
+                options.query_length = strlen(optarg);
+                break;
+            default:
+                usage(program);
+        }
+    }
 
-    snprintf(buffer, sizeof(buffer), "\x1b[%d;%dH", y, x);
-    buffer_append(&content, buffer, strlen(buffer));
+    if (optind != argc) usage(program);
 
-    if (state.work_mode == WM_INSERT) {
-        buffer_append(&content, "\x1b[?25h", 6);
-    }
+    char *default_filename = filename ? NULL : get_default_filename();
+    int in = STDIN_FILENO;
 
-    write(STDOUT_FILENO, content.string, content.length);
-    buffer_free(&content);
-}
+    if (filename == NULL) filename = default_filename;
+    if (filename == NULL) usage(program);
 
-void when_open(char *filename) {
-    free(state.filename);
-    state.filename = strdup(filename);
+    if (strcmp(filename, "-") != 0 && (in = open(filename, O_RDONLY)) == -1) {
+        fprintf(stderr, "todo: %s: %s\n", filename, strerror(errno));
+        free(default_filename);
+        return 1;
+    }
 
-    FILE *file = fopen(filename, "a+");
-    if (!file) die("fopen");
+    free(default_filename);
 
-    char *line = NULL;
-    size_t lines_captured = 0;
-    ssize_t line_length;
+    if (export_stream(in, STDOUT_FILENO, &options) == -1) {
+        fprintf(stderr, "todo: export: %s\n", strerror(errno));
+        return 1;
+    }
 
-    while((line_length = getline(&line, &lines_captured, file)) != -1) {
-        while (line_length > 0 &&
-            (line[line_length - 1] == '\n' || line[line_length - 1] == '\r')) {
-                line_length--;
-            }
+    return 0;
+}
 
-        if (line_length > 2 && line[1] == ' ' &&
-            (line[0] == ' ' || line[0] == '-')) {
-            int done = line[0] == '-' ? 1 : 0;
-            push_todo(state.stats.count, &line[2], line_length - 2, done);
-        } else {
-            continue;
+int main(int argc, char *argv[]) {
+    char *filename = NULL;
+    char *trace = NULL;
+    int opt;
+
+    state.sync = WRITER_SYNC_SAVE;
+
+    while ((opt = getopt(argc, argv, "+s:f:t:")) != -1) {
+        switch (opt) {
+            case 's':
+                state.sync = parse_sync(optarg);
+                if (state.sync == -2) usage(argv[0]);
+                break;
+            case 'f':
+                filename = optarg;
+                break;
+            case 't':
+                trace = optarg;
+                break;
+            default:
+                usage(argv[0]);
         }
     }
 
-    free(line);
-    fclose(file);
+    if (optind < argc && strcmp(argv[optind], "export") == 0) {
+        return export_run(filename, argc - optind, &argv[optind], argv[0]);
+    }
 
-}
+    init();
 
-void init() {
-    state.cursor.x = 3;
-    state.cursor.y = 0;
-    state.stats.count = 0;
-    state.todos = NULL;
-    state.row_offset = 0;
-    state.work_mode = WM_NORMAL;
-    state.status_message[0] = '\0';
-    state.status_message_time = 0;
-    state.insertion_mode = IM_AFTER;
-
-    if (get_window_size(&state.screen_rows, &state.screen_cols) == -1) {
-        die("get_window_size");
+    if (trace != NULL && trace_open(&state.trace, trace) == -1) {
+        fprintf(stderr, "todo: %s: %s\n", trace, strerror(errno));
+        return 1;
     }
 
-    state.screen_rows -= 2;
-}
+    if (optind < argc && (batch_known(argv[optind]) ||
+        strcmp(argv[optind], "serve") == 0)) {
+        char *default_filename = filename ? NULL : get_default_filename();
+        int serving = strcmp(argv[optind], "serve") == 0;
 
-char *get_default_filename() {
-    char *home_dir = getenv("HOME");
+        if (filename == NULL && default_filename == NULL) usage(argv[0]);
+        if (serving && optind + 1 != argc) usage(argv[0]);
 
-    if (home_dir) {
-        char *default_filename = "/.todos.txt";
+        if (filename == NULL) filename = default_filename;
 
-        int home_dir_length = strlen(home_dir);
-        int default_filename_length = strlen(default_filename);
-        int length = home_dir_length + default_filename_length + 1;
+        if (!serving && served(filename)) {
+            fprintf(stderr, "todo: %s is served by a running server\n", filename);
+            return 1;
+        }
 
-        char *filename = malloc(length);
+        state.batch = 1;
+        when_open(filename);
+        free(default_filename);
+        load_all();
 
-        strcpy(filename, home_dir);
-        strcpy(&filename[home_dir_length], default_filename);
-        filename[length] = '\0';
+        int result = serving ? serve() : batch_run(argc - optind, &argv[optind]);
 
-        return filename;
-    } else {
-        return NULL;
+        trace_close(&state.trace);
+        if (result == -1) usage(argv[0]);
+
+        return result;
     }
-}
 
-int main(int argc, char *argv[]) {
+    if (filename == NULL && optind < argc) filename = argv[optind++];
+    if (optind < argc) usage(argv[0]);
+
     enable_raw_mode();
     on_die(clear_screen);
-    init();
+    init_window();
 
-    if (argc >= 2) {
-        when_open(argv[1]);
+    if (filename) {
+        when_open(filename);
     } else {
-        char *filename = get_default_filename();
+        filename = get_default_filename();
 
         if (filename) {
             when_open(filename);
@@ -724,7 +608,7 @@ int main(int argc, char *argv[]) {
 
     while (1) {
         refresh_screen();
-        process_keys();
+        wait_for_events();
     }
 
     return 0;
@@ -0,0 +1,206 @@
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "protocol.h"
+
+#define PROTOCOL_READ_SIZE (1 << 16)
+
+char *protocol_path(const char *filename) {
+    size_t length = strlen(filename);
+    char *path = malloc(length + sizeof(PROTOCOL_SUFFIX));
+
+    if (path == NULL) return NULL;
+
+    memcpy(path, filename, length);
+    memcpy(&path[length], PROTOCOL_SUFFIX, sizeof(PROTOCOL_SUFFIX));
+
+    return path;
+}
+
+int protocol_address(struct sockaddr_un *address, const char *path) {
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, path);
+
+    return 0;
+}
+
+int protocol_connect(const char *path) {
+    struct sockaddr_un address;
+
+    if (protocol_address(&address, path) == -1) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    return fd;
+}
+
+int protocol_listen(const char *path) {
+    struct sockaddr_un address;
+
+    if (protocol_address(&address, path) == -1) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd == -1) return -1;
+
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        int peer = errno == EADDRINUSE ? protocol_connect(path) : -1;
+
+        if (peer != -1 || errno != ECONNREFUSED || unlink(path) == -1 ||
+            bind(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+            if (peer != -1) {
+                close(peer);
+                errno = EADDRINUSE;
+            }
+
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+    }
+
+    if (listen(fd, 16) == -1) {
+        int saved = errno;
+        close(fd);
+        unlink(path);
+        errno = saved;
+        return -1;
+    }
+
+    return fd;
+}
+
+void protocol_send(struct protocol_stream *stream,
+    const struct protocol_message *message, const char *payload) {
+    buffer_append(&stream->out, (const char *) message, sizeof(*message));
+    buffer_append(&stream->out, payload, message->length);
+}
+
+void protocol_item(struct buffer *dest, const char *string, int length, int done) {
+    uint32_t size = length;
+    char flag = done != 0;
+
+    buffer_append(dest, (const char *) &size, sizeof(size));
+    buffer_append_char(dest, flag);
+    buffer_append(dest, string, length);
+}
+
+const char *protocol_next_item(const char *p, const char *end,
+    const char **string, int *length, int *done) {
+    uint32_t size;
+
+    if (end - p < (long) sizeof(size) + 1) return NULL;
+
+    memcpy(&size, p, sizeof(size));
+    p += sizeof(size);
+
+    if (size > (size_t) (end - p - 1)) return NULL;
+
+    *done = *p++ != 0;
+    *string = p;
+    *length = size;
+
+    return p + size;
+}
+
+int protocol_write(struct protocol_stream *stream) {
+    int written = 0;
+
+    while (written < stream->out.length) {
+        ssize_t n = write(stream->fd, &stream->out.string[written],
+            stream->out.length - written);
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            return -1;
+        }
+
+        written += n;
+    }
+
+    if (written > 0) {
+        stream->out.length -= written;
+        memmove(stream->out.string, &stream->out.string[written], stream->out.length);
+    }
+
+    return stream->out.length;
+}
+
+int protocol_read(struct protocol_stream *stream) {
+    struct buffer *in = &stream->in;
+
+    if (stream->start > 0) {
+        in->length -= stream->start;
+        memmove(in->string, &in->string[stream->start], in->length);
+        stream->start = 0;
+    }
+
+    if (buffer_reserve(in, PROTOCOL_READ_SIZE) == -1) return -1;
+
+    ssize_t n = read(stream->fd, &in->string[in->length], PROTOCOL_READ_SIZE);
+
+    if (n == 0) {
+        errno = ECONNRESET;
+        return -1;
+    }
+
+    if (n == -1) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+
+    in->length += n;
+
+    return n;
+}
+
+int protocol_next(struct protocol_stream *stream,
+    struct protocol_message *message, const char **payload) {
+    int available = stream->in.length - stream->start;
+
+    if (available < (int) sizeof(*message)) return 0;
+
+    const char *p = &stream->in.string[stream->start];
+
+    memcpy(message, p, sizeof(*message));
+
+    if (message->length > PROTOCOL_MAX_PAYLOAD) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    if (available - (int) sizeof(*message) < (int) message->length) return 0;
+
+    *payload = p + sizeof(*message);
+    stream->start += sizeof(*message) + message->length;
+
+    return 1;
+}
+
+void protocol_close(struct protocol_stream *stream) {
+    if (stream->fd != -1) close(stream->fd);
+    buffer_free(&stream->in);
+    buffer_free(&stream->out);
+    stream->fd = -1;
+    stream->start = 0;
+}
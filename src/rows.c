@@ -0,0 +1,60 @@
+#include "rows.h"
+
+void row_cache_free(struct row_cache *cache) {
+    for (int i = 0; i < cache->slots; i++) {
+        buffer_free(&cache->entries[i].bytes);
+    }
+
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->slots = 0;
+}
+
+void row_cache_resize(struct row_cache *cache, int slots) {
+    if (cache->slots == slots) return;
+
+    row_cache_free(cache);
+
+    cache->entries = calloc(slots, sizeof(struct row_entry));
+    if (cache->entries == NULL) return;
+
+    cache->slots = slots;
+    row_cache_clear(cache);
+}
+
+struct buffer *row_cache_lookup(struct row_cache *cache, int index, int key) {
+    if (cache->slots == 0) return NULL;
+
+    struct row_entry *entry = &cache->entries[index % cache->slots];
+
+    if (entry->index != index || entry->key != key) return NULL;
+
+    return &entry->bytes;
+}
+
+void row_cache_store(struct row_cache *cache, int index, int key,
+    const struct buffer *bytes) {
+    if (cache->slots == 0) return;
+
+    struct row_entry *entry = &cache->entries[index % cache->slots];
+
+    entry->index = index;
+    entry->key = key;
+    entry->bytes.length = 0;
+
+    if (bytes->length) buffer_append(&entry->bytes, bytes->string, bytes->length);
+}
+
+void row_cache_invalidate(struct row_cache *cache, int index) {
+    if (cache->slots == 0) return;
+
+    struct row_entry *entry = &cache->entries[index % cache->slots];
+
+    if (entry->index == index) entry->index = -1;
+}
+
+void row_cache_clear(struct row_cache *cache) {
+    for (int i = 0; i < cache->slots; i++) {
+        cache->entries[i].index = -1;
+    }
+}
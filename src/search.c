@@ -0,0 +1,144 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "search.h"
+
+#define SEARCH_PAGE_SIZE 4096
+
+int search_page_safe(const char *at, int width) {
+    return ((uintptr_t) at & (SEARCH_PAGE_SIZE - 1)) <= SEARCH_PAGE_SIZE - (uintptr_t) width;
+}
+
+int search_equal(const char *a, const char *b, int length, int ignore_case) {
+    if (!ignore_case) return memcmp(a, b, length) == 0;
+
+    for (int i = 0; i < length; i++) {
+        if (tolower((unsigned char) a[i]) != tolower((unsigned char) b[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+int search_has_upper(const char *string, int length) {
+    for (int i = 0; i < length; i++) {
+        if (isupper((unsigned char) string[i])) return 1;
+    }
+
+    return 0;
+}
+
+int search_find(const char *haystack, int length,
+    const char *needle, int needle_length, int ignore_case) {
+    if (needle_length == 0) return 0;
+    if (needle_length > length) return -1;
+
+    int last = length - needle_length;
+    int i = 0;
+
+    unsigned char first = needle[0];
+    unsigned char tail = needle[needle_length - 1];
+    unsigned char first_other = first;
+    unsigned char tail_other = tail;
+
+    if (ignore_case) {
+        first = tolower(first);
+        first_other = toupper(first);
+        tail = tolower(tail);
+        tail_other = toupper(tail);
+    }
+
+#if defined(__AVX2__)
+    __m256i first_a = _mm256_set1_epi8(first);
+    __m256i first_b = _mm256_set1_epi8(first_other);
+    __m256i tail_a = _mm256_set1_epi8(tail);
+    __m256i tail_b = _mm256_set1_epi8(tail_other);
+
+    while (i <= last) {
+        int remaining = last + 1 - i;
+
+        if (remaining < 32 && !(search_page_safe(&haystack[i], 32) &&
+            search_page_safe(&haystack[i + needle_length - 1], 32))) break;
+
+        __m256i block_first = _mm256_loadu_si256((const __m256i *) &haystack[i]);
+        __m256i block_tail = _mm256_loadu_si256(
+            (const __m256i *) &haystack[i + needle_length - 1]);
+
+        __m256i match_first = _mm256_or_si256(
+            _mm256_cmpeq_epi8(block_first, first_a),
+            _mm256_cmpeq_epi8(block_first, first_b));
+        __m256i match_tail = _mm256_or_si256(
+            _mm256_cmpeq_epi8(block_tail, tail_a),
+            _mm256_cmpeq_epi8(block_tail, tail_b));
+
+        unsigned int mask = _mm256_movemask_epi8(
+            _mm256_and_si256(match_first, match_tail));
+
+        if (remaining < 32) mask &= (1u << remaining) - 1;
+
+        while (mask) {
+            int at = i + __builtin_ctz(mask);
+
+            if (search_equal(&haystack[at], needle, needle_length, ignore_case))
+                return at;
+
+            mask &= mask - 1;
+        }
+
+        i += 32;
+    }
+#elif defined(__SSE2__)
+    __m128i first_a = _mm_set1_epi8(first);
+    __m128i first_b = _mm_set1_epi8(first_other);
+    __m128i tail_a = _mm_set1_epi8(tail);
+    __m128i tail_b = _mm_set1_epi8(tail_other);
+
+    while (i <= last) {
+        int remaining = last + 1 - i;
+
+        if (remaining < 16 && !(search_page_safe(&haystack[i], 16) &&
+            search_page_safe(&haystack[i + needle_length - 1], 16))) break;
+
+        __m128i block_first = _mm_loadu_si128((const __m128i *) &haystack[i]);
+        __m128i block_tail = _mm_loadu_si128(
+            (const __m128i *) &haystack[i + needle_length - 1]);
+
+        __m128i match_first = _mm_or_si128(
+            _mm_cmpeq_epi8(block_first, first_a),
+            _mm_cmpeq_epi8(block_first, first_b));
+        __m128i match_tail = _mm_or_si128(
+            _mm_cmpeq_epi8(block_tail, tail_a),
+            _mm_cmpeq_epi8(block_tail, tail_b));
+
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(match_first, match_tail));
+
+        if (remaining < 16) mask &= (1u << remaining) - 1;
+
+        while (mask) {
+            int at = i + __builtin_ctz(mask);
+
+            if (search_equal(&haystack[at], needle, needle_length, ignore_case))
+                return at;
+
+            mask &= mask - 1;
+        }
+
+        i += 16;
+    }
+#endif
+
+    for (; i <= last; i++) {
+        unsigned char c = haystack[i];
+
+        if ((c == first || c == first_other) &&
+            search_equal(&haystack[i], needle, needle_length, ignore_case))
+            return i;
+    }
+
+    return -1;
+}
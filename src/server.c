@@ -0,0 +1,108 @@
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "server.h"
+
+int server_open(struct server *server, const char *filename) {
+    server->path = protocol_path(filename);
+    if (server->path == NULL) return -1;
+
+    server->fd = protocol_listen(server->path);
+
+    if (server->fd == -1) {
+        int saved = errno;
+        free(server->path);
+        server->path = NULL;
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+int server_accept(struct server *server) {
+    int fd = accept4(server->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd == -1) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+
+    if (server->count == server->capacity) {
+        int capacity = server->capacity ? server->capacity * 2 : 8;
+        struct server_client *clients = realloc(server->clients,
+            sizeof(struct server_client) * capacity);
+
+        if (clients == NULL) {
+            close(fd);
+            return -1;
+        }
+
+        server->clients = clients;
+        server->capacity = capacity;
+    }
+
+    struct server_client *client = &server->clients[server->count++];
+
+    client->stream = (struct protocol_stream) PROTOCOL_STREAM_INIT;
+    client->stream.fd = fd;
+    client->subscribed = 0;
+    client->stale = 0;
+    client->lagging = 0;
+
+    return 1;
+}
+
+int server_events(struct server *server, struct pollfd *fds) {
+    fds[0].fd = server->fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+
+    for (int i = 0; i < server->count; i++) {
+        struct protocol_stream *stream = &server->clients[i].stream;
+
+        fds[i + 1].fd = stream->fd;
+        fds[i + 1].events = stream->out.length ? POLLIN | POLLOUT : POLLIN;
+        fds[i + 1].revents = 0;
+    }
+
+    return server->count + 1;
+}
+
+void server_broadcast(struct server *server, int except,
+    const struct protocol_message *message, const char *payload) {
+    for (int i = 0; i < server->count; i++) {
+        struct server_client *client = &server->clients[i];
+
+        if (i == except || !client->subscribed) continue;
+
+        if (client->lagging || client->stream.out.length > SERVER_MAX_OUTPUT) {
+            client->lagging = 1;
+            client->stale = 1;
+            continue;
+        }
+
+        protocol_send(&client->stream, message, payload);
+    }
+}
+
+void server_drop(struct server *server, int index) {
+    protocol_close(&server->clients[index].stream);
+    server->clients[index] = server->clients[--server->count];
+}
+
+void server_close(struct server *server) {
+    while (server->count) server_drop(server, server->count - 1);
+
+    if (server->fd != -1) close(server->fd);
+    if (server->path != NULL) unlink(server->path);
+
+    free(server->clients);
+    free(server->path);
+    server->fd = -1;
+    server->path = NULL;
+    server->clients = NULL;
+    server->capacity = 0;
+}
@@ -0,0 +1,295 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "todo.h"
+
+size_t snapshot_sample(size_t length, int sample) {
+    if (length <= SNAPSHOT_SAMPLE_SIZE) return 0;
+
+    return (length - SNAPSHOT_SAMPLE_SIZE) * sample / (SNAPSHOT_SAMPLES - 1);
+}
+
+uint64_t snapshot_fnv(uint64_t hash, const char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+uint64_t snapshot_hash(const char *text, size_t length) {
+    uint64_t hash = snapshot_fnv(0xcbf29ce484222325ULL, (char *) &length,
+        sizeof(length));
+    size_t size = length < SNAPSHOT_SAMPLE_SIZE ? length : SNAPSHOT_SAMPLE_SIZE;
+
+    for (int i = 0; i < SNAPSHOT_SAMPLES; i++) {
+        hash = snapshot_fnv(hash, &text[snapshot_sample(length, i)], size);
+    }
+
+    return hash;
+}
+
+uint64_t snapshot_hash_file(int file, size_t length) {
+    uint64_t hash = snapshot_fnv(0xcbf29ce484222325ULL, (char *) &length,
+        sizeof(length));
+    size_t size = length < SNAPSHOT_SAMPLE_SIZE ? length : SNAPSHOT_SAMPLE_SIZE;
+    char sample[SNAPSHOT_SAMPLE_SIZE];
+
+    for (int i = 0; i < SNAPSHOT_SAMPLES; i++) {
+        if (pread(file, sample, size, snapshot_sample(length, i)) != (ssize_t) size) {
+            return 0;
+        }
+
+        hash = snapshot_fnv(hash, sample, size);
+    }
+
+    return hash;
+}
+
+size_t snapshot_tables(uint32_t count) {
+    size_t length = sizeof(struct snapshot_header) + (size_t) count * 9;
+
+    return (length + 7) & ~(size_t) 7;
+}
+
+char *snapshot_path(const char *filename) {
+    size_t filename_length = strlen(filename);
+    char *path = malloc(filename_length + sizeof(SNAPSHOT_SUFFIX));
+
+    if (path == NULL) return NULL;
+
+    memcpy(path, filename, filename_length);
+    memcpy(&path[filename_length], SNAPSHOT_SUFFIX, sizeof(SNAPSHOT_SUFFIX));
+
+    return path;
+}
+
+const char *snapshot_line(const char *line, const char *end, size_t *length) {
+    const char *eol = memchr(line, '\n', end - line);
+
+    if (eol == NULL) eol = end;
+
+    *length = eol - line;
+
+    while (*length > 0 && line[*length - 1] == '\r') (*length)--;
+
+    return eol < end ? eol + 1 : end;
+}
+
+char *snapshot_build(const char *text, size_t length, const struct stat *st,
+    size_t *snapshot_length) {
+    const char *end = text + length;
+    uint32_t count = 0;
+    size_t blob_length = 0;
+    size_t line_length;
+
+    for (const char *line = text; line < end; ) {
+        const char *next = snapshot_line(line, end, &line_length);
+
+        if (is_todo_line(line, line_length)) {
+            count++;
+            blob_length += line_length - 2;
+        }
+
+        line = next;
+    }
+
+    size_t tables = snapshot_tables(count);
+    char *snapshot = malloc(tables + blob_length);
+
+    if (snapshot == NULL) return NULL;
+
+    struct snapshot_header *header = (struct snapshot_header *) snapshot;
+    uint32_t *offsets = (uint32_t *) &snapshot[sizeof(*header)];
+    uint32_t *lengths = &offsets[count];
+    unsigned char *done = (unsigned char *) &lengths[count];
+    uint32_t offset = tables;
+    const char *line = text;
+
+    memset(header, 0, tables);
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->size = st->st_size;
+    header->mtime_sec = st->st_mtim.tv_sec;
+    header->mtime_nsec = st->st_mtim.tv_nsec;
+    header->inode = st->st_ino;
+    header->hash = snapshot_hash(text, length);
+    header->count = count;
+    header->blob_length = blob_length;
+
+    for (uint32_t i = 0; i < count; ) {
+        const char *next = snapshot_line(line, end, &line_length);
+
+        if (is_todo_line(line, line_length)) {
+            offsets[i] = offset;
+            lengths[i] = line_length - 2;
+            done[i] = line[0] == '-';
+            memcpy(&snapshot[offset], &line[2], line_length - 2);
+
+            offset += line_length - 2;
+            i++;
+        }
+
+        line = next;
+    }
+
+    *snapshot_length = tables + blob_length;
+
+    return snapshot;
+}
+
+int snapshot_write(const char *filename, const char *text, size_t length,
+    const struct stat *st) {
+    if (length > UINT32_MAX / 4) {
+        errno = EFBIG;
+        return -1;
+    }
+
+    size_t snapshot_length;
+    char *snapshot = snapshot_build(text, length, st, &snapshot_length);
+    char *path = snapshot_path(filename);
+
+    if (snapshot == NULL || path == NULL) {
+        free(snapshot);
+        free(path);
+        return -1;
+    }
+
+    size_t path_length = strlen(path);
+    char *temp = malloc(path_length + 8);
+    int file = -1;
+
+    if (temp != NULL) {
+        memcpy(temp, path, path_length);
+        memcpy(&temp[path_length], ".XXXXXX", 8);
+        file = mkstemp(temp);
+    }
+
+    if (file != -1) fchmod(file, st->st_mode & 0777);
+
+    size_t written = 0;
+
+    while (file != -1 && written < snapshot_length) {
+        ssize_t n = write(file, &snapshot[written], snapshot_length - written);
+
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        written += n;
+    }
+
+    int result = file != -1 && written == snapshot_length &&
+        rename(temp, path) == 0 ? 0 : -1;
+    int saved = errno;
+
+    if (file != -1) {
+        if (result == -1) unlink(temp);
+        close(file);
+    }
+
+    free(temp);
+    free(path);
+    free(snapshot);
+    errno = saved;
+
+    return result;
+}
+
+int snapshot_bounded(const struct snapshot_header *header, size_t length) {
+    size_t tables = snapshot_tables(header->count);
+
+    if (length != tables + header->blob_length) return 0;
+
+    const char *map = (const char *) header;
+    const uint32_t *offsets = (const uint32_t *) &map[sizeof(*header)];
+    const uint32_t *lengths = &offsets[header->count];
+    const unsigned char *done = (const unsigned char *) &lengths[header->count];
+
+    for (uint32_t i = 0; i < header->count; i++) {
+        if (offsets[i] < tables || done[i] > 1 ||
+            (size_t) offsets[i] + lengths[i] > length) return 0;
+    }
+
+    return 1;
+}
+
+int snapshot_newer(const struct stat *snapshot_st, const struct stat *st) {
+    return snapshot_st->st_mtim.tv_sec > st->st_mtim.tv_sec ||
+        (snapshot_st->st_mtim.tv_sec == st->st_mtim.tv_sec &&
+         snapshot_st->st_mtim.tv_nsec > st->st_mtim.tv_nsec);
+}
+
+int snapshot_valid(const struct snapshot_header *header, size_t length,
+    const struct stat *snapshot_st, int file, const struct stat *st) {
+    if (length < sizeof(*header) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return 0;
+
+    if (header->size != (uint64_t) st->st_size ||
+        header->mtime_sec != st->st_mtim.tv_sec ||
+        header->mtime_nsec != st->st_mtim.tv_nsec ||
+        header->inode != (uint64_t) st->st_ino) return 0;
+
+    if (!snapshot_bounded(header, length)) return 0;
+
+    if (snapshot_newer(snapshot_st, st)) return 1;
+
+    return header->hash == snapshot_hash_file(file, st->st_size);
+}
+
+int snapshot_open(struct snapshot *snapshot, const char *filename, int file,
+    const struct stat *st) {
+    char *path = snapshot_path(filename);
+
+    if (path == NULL) return -1;
+
+    int fd = open(path, O_RDONLY);
+
+    free(path);
+
+    if (fd == -1) return -1;
+
+    struct stat snapshot_st;
+
+    if (fstat(fd, &snapshot_st) == -1 ||
+        snapshot_st.st_size < (off_t) sizeof(struct snapshot_header)) {
+        close(fd);
+        return -1;
+    }
+
+    char *map = mmap(NULL, snapshot_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (map == MAP_FAILED) return -1;
+
+    const struct snapshot_header *header = (const struct snapshot_header *) map;
+
+    if (!snapshot_valid(header, snapshot_st.st_size, &snapshot_st, file, st)) {
+        munmap(map, snapshot_st.st_size);
+        return -1;
+    }
+
+    snapshot->map = map;
+    snapshot->length = snapshot_st.st_size;
+    snapshot->count = header->count;
+    snapshot->offsets = (const uint32_t *) &map[sizeof(*header)];
+    snapshot->lengths = &snapshot->offsets[header->count];
+    snapshot->done = (const unsigned char *) &snapshot->lengths[header->count];
+
+    return 0;
+}
+
+void snapshot_close(struct snapshot *snapshot) {
+    if (snapshot->map != NULL) munmap(snapshot->map, snapshot->length);
+
+    snapshot->map = NULL;
+    snapshot->length = 0;
+}
@@ -0,0 +1,37 @@
+#include "style.h"
+
+void style_begin(struct style *style, struct buffer *dest) {
+    style->dest = dest;
+    style->current = STYLE_PLAIN;
+}
+
+void style_switch(struct style *style, int flags) {
+    char sequence[16] = "\x1b[0";
+    int length = 3;
+
+    if (flags & STYLE_STRIKE) {
+        memcpy(&sequence[length], ";9", 2);
+        length += 2;
+    }
+
+    if (flags & STYLE_MAGENTA) {
+        memcpy(&sequence[length], ";35", 3);
+        length += 3;
+    }
+
+    sequence[length++] = 'm';
+
+    buffer_append(style->dest, sequence, length);
+    style->current = flags;
+}
+
+void style_append(struct style *style, int flags, const char *string, int length) {
+    if (length <= 0) return;
+    if (flags != style->current) style_switch(style, flags);
+
+    buffer_append(style->dest, string, length);
+}
+
+void style_end(struct style *style) {
+    if (style->current != STYLE_PLAIN) style_switch(style, STYLE_PLAIN);
+}
@@ -17,14 +17,18 @@ void enable_raw_mode() {
     raw.c_cflag |= ~(CS8);
     raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
     raw.c_cc[VMIN] = 0;
-    raw.c_cc[VTIME] = 1;
+    raw.c_cc[VTIME] = 0;
 
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) {
         die("tcsetattr");
     }
+
+    write(STDOUT_FILENO, "\x1b[?2004h", 8);
 }
 
 void disable_raw_mode() {
+    write(STDOUT_FILENO, "\x1b[?2004l", 8);
+
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &original_termios) == -1) {
         die("tcsetattr");
     }
@@ -51,6 +55,9 @@ int get_cursor_position(int *rows, int *cols) {
     if (write(STDOUT_FILENO, "\x1b[6n", 4) != 4) return -1;
 
     while (i < sizeof(buffer) - 1) {
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+
+        if (poll(&pfd, 1, 1000) != 1) break;
         if (read(STDIN_FILENO, &buffer[i], 1) != 1) break;
         if (buffer[i] == 'R') break;
         i++;
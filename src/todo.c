@@ -0,0 +1,100 @@
+#include "todo.h"
+
+int is_todo_line(const char *line, size_t length) {
+    return length > 2 && line[1] == ' ' && (line[0] == ' ' || line[0] == '-');
+}
+
+void todo_own(todo *src) {
+    if (src->capacity) return;
+
+    char *string = malloc(src->size + 1);
+    if (src->size) memcpy(string, src->string, src->size);
+    string[src->size] = '\0';
+
+    src->string = string;
+    src->capacity = src->size + 1;
+    src->gap = src->size;
+}
+
+void todo_move_gap(todo *src, int at) {
+    int gap_length = src->capacity - src->size;
+
+    if (at < src->gap) {
+        memmove(&src->string[at + gap_length], &src->string[at], src->gap - at);
+    } else if (at > src->gap) {
+        memmove(&src->string[src->gap], &src->string[src->gap + gap_length],
+            at - src->gap);
+    }
+
+    src->gap = at;
+}
+
+void todo_grow(todo *src) {
+    int capacity = src->capacity * 2;
+    if (capacity < TODO_MIN_CAPACITY) capacity = TODO_MIN_CAPACITY;
+
+    int tail = src->size - src->gap;
+    char *string = realloc(src->string, capacity);
+
+    if (string == NULL) return;
+
+    memmove(&string[capacity - tail], &string[src->capacity - tail], tail);
+
+    src->string = string;
+    src->capacity = capacity;
+}
+
+void todo_flatten(todo *src) {
+    if (src->capacity == 0) return;
+
+    todo_move_gap(src, src->size);
+    src->string[src->size] = '\0';
+}
+
+const char *todo_span(const todo *src, int at, int *length) {
+    if (at < src->gap) {
+        *length = src->gap - at;
+        return &src->string[at];
+    }
+
+    *length = src->size - at;
+    if (*length <= 0) return src->string;
+
+    return &src->string[at + src->capacity - src->size];
+}
+
+void todo_insert_text(todo *dest, int at, const char *string, int length) {
+    if (at < 0 || at > dest->size) at = dest->size;
+
+    todo_own(dest);
+
+    while (dest->capacity - dest->size <= length) {
+        int capacity = dest->capacity;
+
+        todo_grow(dest);
+        if (dest->capacity == capacity) return;
+    }
+
+    todo_move_gap(dest, at);
+    memcpy(&dest->string[dest->gap], string, length);
+    dest->gap += length;
+    dest->size += length;
+}
+
+void todo_insert_char(todo *dest, int at, int c) {
+    char ch = c;
+    todo_insert_text(dest, at, &ch, 1);
+}
+
+void todo_del_char(todo *src, int at) {
+    if (at < 0 || at >= src->size) return;
+
+    todo_own(src);
+    todo_move_gap(src, at + 1);
+    src->gap--;
+    src->size--;
+}
+
+void free_todo(todo *src) {
+    if (src->capacity) free(src->string);
+}
@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+__thread struct trace_counters trace_counters;
+
+uint64_t trace_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int trace_open(struct trace *trace, const char *path) {
+    trace->file = fopen(path, "w");
+    if (trace->file == NULL) return -1;
+
+    setvbuf(trace->file, NULL, _IOFBF, 1 << 16);
+    fputs("[\n", trace->file);
+
+    trace->events = 0;
+    trace->origin = trace_now();
+    trace->active = 1;
+
+    return 0;
+}
+
+void trace_toggle(struct trace *trace) {
+    trace->hud = !trace->hud;
+    trace->active = trace->hud || trace->file != NULL;
+    trace->frame.start = 0;
+
+    if (trace->hud) {
+        trace->frame_count = 0;
+        trace->last = 0;
+        memset(&trace->last_counters, 0, sizeof(trace->last_counters));
+    }
+}
+
+void trace_begin(struct trace *trace, struct trace_span *span) {
+    if (!trace->active) {
+        span->start = 0;
+        return;
+    }
+
+    span->counters = trace_counters;
+    span->start = trace_now();
+}
+
+uint64_t trace_end(struct trace *trace, struct trace_span *span, const char *name) {
+    if (!trace->active || span->start == 0) return 0;
+
+    uint64_t end = trace_now();
+    uint64_t duration = end - span->start;
+
+    span->counters.bytes = trace_counters.bytes - span->counters.bytes;
+    span->counters.allocations = trace_counters.allocations - span->counters.allocations;
+    span->counters.syscalls = trace_counters.syscalls - span->counters.syscalls;
+
+    if (trace->file != NULL && span->start >= trace->origin) {
+        fprintf(trace->file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+            "\"dur\":%.3f,\"pid\":%d,\"tid\":1,\"args\":{\"bytes\":%lu,"
+            "\"allocations\":%lu,\"syscalls\":%lu}}",
+            trace->events++ ? ",\n" : "", name,
+            (span->start - trace->origin) / 1e3, duration / 1e3, (int) getpid(),
+            span->counters.bytes, span->counters.allocations,
+            span->counters.syscalls);
+    }
+
+    return duration;
+}
+
+void trace_wake(struct trace *trace) {
+    if (!trace->active || trace->frame.start) return;
+
+    trace_begin(trace, &trace->frame);
+}
+
+void trace_frame(struct trace *trace) {
+    if (!trace->active || trace->frame.start == 0) return;
+
+    trace->last = trace_end(trace, &trace->frame, "frame");
+    trace->last_counters = trace->frame.counters;
+    trace->frames[trace->frame_count++ % TRACE_FRAMES] = trace->last;
+    trace->frame.start = 0;
+}
+
+int trace_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+uint64_t trace_percentile(struct trace *trace, int percent) {
+    uint64_t sorted[TRACE_FRAMES];
+    int count = trace->frame_count < TRACE_FRAMES ? trace->frame_count : TRACE_FRAMES;
+
+    if (count == 0) return 0;
+
+    memcpy(sorted, trace->frames, sizeof(uint64_t) * count);
+    qsort(sorted, count, sizeof(uint64_t), trace_compare);
+
+    return sorted[(count * percent + 99) / 100 - 1];
+}
+
+void trace_close(struct trace *trace) {
+    if (trace->file != NULL) {
+        fputs("\n]\n", trace->file);
+        fclose(trace->file);
+        trace->file = NULL;
+    }
+
+    trace->active = trace->hud;
+}
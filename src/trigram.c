@@ -0,0 +1,263 @@
+#include <ctype.h>
+#include <stdint.h>
+
+#include "search.h"
+#include "trigram.h"
+
+int trigram_bucket(unsigned char a, unsigned char b, unsigned char c) {
+    uint32_t key = tolower(a) << 16 | tolower(b) << 8 | tolower(c);
+
+    return (key * 2654435761u) >> 16 & (TRIGRAM_BUCKETS - 1);
+}
+
+int trigram_reserve(struct trigram_index *index, int id) {
+    if (id < index->ids) return 0;
+
+    int ids = index->ids ? index->ids : 16;
+    while (ids <= id) ids *= 2;
+
+    int *counts = realloc(index->counts, sizeof(int) * ids);
+    if (counts == NULL) return -1;
+    index->counts = counts;
+
+    unsigned int *seen = realloc(index->seen, sizeof(unsigned int) * ids);
+    if (seen == NULL) return -1;
+    index->seen = seen;
+
+    memset(&counts[index->ids], 0, sizeof(int) * (ids - index->ids));
+    memset(&seen[index->ids], 0, sizeof(unsigned int) * (ids - index->ids));
+    index->ids = ids;
+
+    return 0;
+}
+
+int trigram_post(struct posting *posting, int id) {
+    if (posting->length && posting->ids[posting->length - 1] == id) return 0;
+
+    if (posting->length == posting->capacity) {
+        int capacity = posting->capacity ? posting->capacity * 2 : 4;
+        int *ids = realloc(posting->ids, sizeof(int) * capacity);
+
+        if (ids == NULL) return 0;
+
+        posting->ids = ids;
+        posting->capacity = capacity;
+    }
+
+    posting->ids[posting->length++] = id;
+
+    return 1;
+}
+
+void trigram_add(struct trigram_index *index, int id, const todo *text) {
+    if (index->buckets == NULL || trigram_reserve(index, id) == -1) return;
+
+    unsigned char window[3];
+    int filled = 0;
+    int added = 0;
+    int at = 0;
+
+    while (at < text->size) {
+        int span_length;
+        const char *span = todo_span(text, at, &span_length);
+
+        for (int i = 0; i < span_length; i++) {
+            window[0] = window[1];
+            window[1] = window[2];
+            window[2] = span[i];
+
+            if (++filled >= 3) {
+                added += trigram_post(&index->buckets[
+                    trigram_bucket(window[0], window[1], window[2])], id);
+            }
+        }
+
+        at += span_length;
+    }
+
+    index->counts[id] += added;
+    index->live += added;
+}
+
+void trigram_insert(struct trigram_index *index, struct todo_list *list, int at) {
+    todo text = list_text(list, at);
+
+    trigram_add(index, list_id(list, at), &text);
+}
+
+void trigram_remove(struct trigram_index *index, int id) {
+    if (index->buckets == NULL || id >= index->ids) return;
+
+    index->live -= index->counts[id];
+    index->stale += index->counts[id];
+    index->counts[id] = 0;
+}
+
+void trigram_update(struct trigram_index *index, int id, const todo *text) {
+    trigram_remove(index, id);
+    trigram_add(index, id, text);
+}
+
+void trigram_clear(struct trigram_index *index) {
+    for (int i = 0; i < TRIGRAM_BUCKETS; i++) {
+        index->buckets[i].length = 0;
+    }
+
+    if (index->ids) memset(index->counts, 0, sizeof(int) * index->ids);
+
+    index->live = 0;
+    index->stale = 0;
+}
+
+int trigram_init(struct trigram_index *index) {
+    if (index->buckets == NULL) {
+        index->buckets = calloc(TRIGRAM_BUCKETS, sizeof(struct posting));
+        if (index->buckets == NULL) return -1;
+    } else {
+        trigram_clear(index);
+    }
+
+    return 0;
+}
+
+int trigram_build(struct trigram_index *index, struct todo_list *list) {
+    if (trigram_init(index) == -1) return -1;
+
+    int count = list_count(list);
+
+    for (int i = 0; i < count; i++) trigram_insert(index, list, i);
+
+    return 0;
+}
+
+int trigram_push(int **rows, int *capacity, int length, int at) {
+    if (length == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 64;
+        int *resized = realloc(*rows, sizeof(int) * grown);
+
+        if (resized == NULL) return length;
+
+        *rows = resized;
+        *capacity = grown;
+    }
+
+    (*rows)[length] = at;
+
+    return length + 1;
+}
+
+int trigram_match(const todo *text, const char *query, int length) {
+    int at = 0;
+
+    while (at < length) {
+        while (at < length && query[at] == ' ') at++;
+
+        int end = at;
+        while (end < length && query[end] != ' ') end++;
+
+        if (end > at && search_find(text->string, text->size,
+            &query[at], end - at, 1) == -1) return 0;
+
+        at = end;
+    }
+
+    return 1;
+}
+
+int trigram_compare(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+
+    return (x > y) - (x < y);
+}
+
+struct posting *trigram_candidates(struct trigram_index *index,
+    const char *query, int length) {
+    struct posting *best = NULL;
+
+    for (int i = 0; i + 2 < length; i++) {
+        if (query[i] == ' ' || query[i + 1] == ' ' || query[i + 2] == ' ')
+            continue;
+
+        struct posting *posting = &index->buckets[
+            trigram_bucket(query[i], query[i + 1], query[i + 2])];
+
+        if (best == NULL || posting->length < best->length) best = posting;
+    }
+
+    return best;
+}
+
+int trigram_filter(struct trigram_index *index, struct todo_list *list,
+    const char *query, int length, int **rows, int *capacity, int narrow) {
+    int count = list_count(list);
+    int found = 0;
+
+    if (index->buckets && index->stale > index->live &&
+        index->stale > TRIGRAM_MIN_STALE) {
+        trigram_build(index, list);
+    }
+
+    struct posting *candidates = index->buckets ?
+        trigram_candidates(index, query, length) : NULL;
+
+    if (narrow >= 0 && (candidates == NULL || narrow <= candidates->length)) {
+        for (int i = 0; i < narrow; i++) {
+            todo text = list_text(list, (*rows)[i]);
+
+            if (trigram_match(&text, query, length))
+                (*rows)[found++] = (*rows)[i];
+        }
+
+        return found;
+    }
+
+    if (candidates == NULL) {
+        for (int i = 0; i < count; i++) {
+            todo text = list_text(list, i);
+
+            if (trigram_match(&text, query, length))
+                found = trigram_push(rows, capacity, found, i);
+        }
+
+        return found;
+    }
+
+    if (++index->generation == 0) {
+        memset(index->seen, 0, sizeof(unsigned int) * index->ids);
+        index->generation = 1;
+    }
+
+    for (int i = 0; i < candidates->length; i++) {
+        int id = candidates->ids[i];
+
+        if (index->seen[id] == index->generation) continue;
+        index->seen[id] = index->generation;
+
+        int at = list_index_of(list, id);
+
+        if (at < 0 || at >= count || list_id(list, at) != id) continue;
+
+        todo text = list_text(list, at);
+
+        if (trigram_match(&text, query, length))
+            found = trigram_push(rows, capacity, found, at);
+    }
+
+    qsort(*rows, found, sizeof(int), trigram_compare);
+
+    return found;
+}
+
+void trigram_free(struct trigram_index *index) {
+    if (index->buckets) {
+        for (int i = 0; i < TRIGRAM_BUCKETS; i++) {
+            free(index->buckets[i].ids);
+        }
+    }
+
+    free(index->buckets);
+    free(index->counts);
+    free(index->seen);
+    *index = (struct trigram_index) TRIGRAM_INIT;
+}
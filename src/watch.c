@@ -0,0 +1,73 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "watch.h"
+
+int watch_open(struct watch *watch, const char *filename) {
+    char *path = realpath(filename, NULL);
+
+    if (path == NULL) path = strdup(filename);
+    if (path == NULL) return -1;
+
+    char *directory = strdup(path);
+    char *name = path;
+
+    if (directory == NULL) {
+        free(name);
+        return -1;
+    }
+
+    watch->name = strdup(basename(name));
+    free(name);
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (watch->fd != -1 && watch->name != NULL) {
+        watch->wd = inotify_add_watch(watch->fd, dirname(directory),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    }
+
+    free(directory);
+
+    if (watch->wd == -1) {
+        int saved = errno;
+        watch_close(watch);
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+int watch_changed(struct watch *watch) {
+    char events[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t n;
+
+    while ((n = read(watch->fd, events, sizeof(events))) > 0) {
+        for (char *p = events; p < events + n; ) {
+            struct inotify_event *event = (struct inotify_event *) p;
+
+            if (event->len && strcmp(event->name, watch->name) == 0) changed = 1;
+
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return changed;
+}
+
+void watch_close(struct watch *watch) {
+    if (watch->fd != -1) close(watch->fd);
+
+    free(watch->name);
+    watch->fd = -1;
+    watch->wd = -1;
+    watch->name = NULL;
+}
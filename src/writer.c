@@ -0,0 +1,474 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libgen.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "writer.h"
+
+void writer_status(struct writer *writer, int error, const char *fmt, va_list ap) {
+    pthread_mutex_lock(&writer->lock);
+    vsnprintf(writer->message, sizeof(writer->message), fmt, ap);
+
+    if (error) {
+        writer->error = error;
+        memcpy(writer->failure, writer->message, sizeof(writer->failure));
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    if (write(writer->notify, "s", 1) == -1) {}
+}
+
+void writer_report(struct writer *writer, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    writer_status(writer, 0, fmt, ap);
+    va_end(ap);
+}
+
+void writer_fail(struct writer *writer, const char *fmt, ...) {
+    int error = errno;
+    va_list ap;
+
+    va_start(ap, fmt);
+    writer_status(writer, error ? error : EIO, fmt, ap);
+    va_end(ap);
+}
+
+int writer_write_all(int fd, const char *string, int length) {
+    int written = 0;
+
+    while (written < length) {
+        ssize_t n = write(fd, &string[written], length - written);
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        written += n;
+    }
+
+    return 0;
+}
+
+int writer_write_file(struct writer *writer, const char *buffer, int length) {
+    int filename_length = strlen(writer->path);
+    char *temp = malloc(filename_length + 8);
+
+    if (temp == NULL) return -1;
+
+    memcpy(temp, writer->path, filename_length);
+    memcpy(&temp[filename_length], ".XXXXXX", 8);
+
+    int file = mkstemp(temp);
+
+    if (file == -1) {
+        free(temp);
+        return -1;
+    }
+
+    struct stat st;
+
+    if (stat(writer->path, &st) == 0) {
+        fchmod(file, st.st_mode & 07777);
+    }
+
+    if (writer_write_all(file, buffer, length) == -1 ||
+        fdatasync(file) == -1 ||
+        fstat(file, &st) == -1) {
+        int saved = errno;
+        unlink(temp);
+        close(file);
+        free(temp);
+        errno = saved;
+        return -1;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->written = st;
+    pthread_mutex_unlock(&writer->lock);
+
+    if (rename(temp, writer->path) == -1) {
+        int saved = errno;
+        unlink(temp);
+        close(file);
+        free(temp);
+        errno = saved;
+        return -1;
+    }
+
+    if (journal_reset(writer->journal, file) == -1) {
+        writer_fail(writer, "Can't reset journal: %s", strerror(errno));
+    } else {
+        writer_report(writer, "%d bytes written to disk", length);
+    }
+
+    if (snapshot_write(writer->filename, buffer, length, &st) == -1) {
+        writer_report(writer, "Can't write snapshot: %s", strerror(errno));
+    }
+
+    close(file);
+    free(temp);
+
+    return 0;
+}
+
+int writer_reset(struct writer *writer) {
+    int file = open(writer->filename, O_RDONLY);
+
+    if (file == -1) return -1;
+
+    int result = journal_reset(writer->journal, file);
+    int saved = errno;
+
+    close(file);
+    errno = saved;
+
+    return result;
+}
+
+int writer_journal(struct writer *writer, struct buffer *records) {
+    if (records->length == 0) return 0;
+
+    if (journal_write(writer->journal, records->string, records->length) == -1) {
+        writer_fail(writer, "Can't write journal: %s", strerror(errno));
+        return 0;
+    }
+
+    writer_report(writer, "%d bytes written to journal", records->length);
+
+    return WRITER_UNSYNCED_JOURNAL;
+}
+
+int writer_sync_directory(struct writer *writer) {
+    char *path = strdup(writer->path);
+
+    if (path == NULL) return -1;
+
+    int directory = open(dirname(path), O_RDONLY | O_DIRECTORY);
+
+    free(path);
+
+    if (directory == -1) return -1;
+
+    int result = fsync(directory);
+    int saved = errno;
+
+    close(directory);
+    errno = saved;
+
+    return result;
+}
+
+void writer_sync(struct writer *writer, int unsynced) {
+    if (unsynced & WRITER_UNSYNCED_JOURNAL && writer->journal->fd != -1 &&
+        fdatasync(writer->journal->fd) == -1) {
+        writer_fail(writer, "Can't sync journal: %s", strerror(errno));
+    }
+
+    if (unsynced & WRITER_UNSYNCED_DIRECTORY &&
+        writer_sync_directory(writer) == -1) {
+        writer_fail(writer, "Can't sync directory: %s", strerror(errno));
+    }
+}
+
+long writer_elapsed(const struct timespec *since) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - since->tv_sec) * 1000 +
+        (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+void writer_deadline(struct timespec *deadline, const struct timespec *from, long ms) {
+    deadline->tv_sec = from->tv_sec + ms / 1000;
+    deadline->tv_nsec = from->tv_nsec + ms % 1000 * 1000000;
+
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+int writer_pending(struct writer *writer) {
+    return writer->saving || writer->head.length || writer->tail.length;
+}
+
+int writer_due(struct writer *writer) {
+    if (!writer->unsynced || writer->sync == WRITER_SYNC_EXIT) {
+        return writer->unsynced && writer->flushing;
+    }
+
+    return writer->sync == WRITER_SYNC_SAVE || writer->flushing ||
+        writer_elapsed(&writer->synced) >= writer->sync;
+}
+
+void writer_wait(struct writer *writer) {
+    while (!writer_pending(writer) && !writer_due(writer)) {
+        if (writer->unsynced && writer->sync > 0) {
+            struct timespec deadline;
+            writer_deadline(&deadline, &writer->synced, writer->sync);
+            pthread_cond_timedwait(&writer->changed, &writer->lock, &deadline);
+        } else {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+    }
+
+    while (writer_pending(writer) && !writer->flushing) {
+        long quiet = WRITER_QUIET - writer_elapsed(&writer->last);
+        long delay = WRITER_MAX_DELAY - writer_elapsed(&writer->first);
+        long wait = quiet < delay ? quiet : delay;
+
+        if (wait <= 0) break;
+
+        struct timespec now, deadline;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        writer_deadline(&deadline, &now, wait);
+        pthread_cond_timedwait(&writer->changed, &writer->lock, &deadline);
+    }
+}
+
+void *writer_run(void *data) {
+    struct writer *writer = data;
+    struct buffer head = BUFFER_INIT;
+    struct buffer tail = BUFFER_INIT;
+
+    pthread_mutex_lock(&writer->lock);
+
+    while (1) {
+        writer_wait(writer);
+
+        struct buffer swap = head;
+        head = writer->head;
+        writer->head = swap;
+        swap = tail;
+        tail = writer->tail;
+        writer->tail = swap;
+
+        char *snapshot = writer->snapshot;
+        int snapshot_length = writer->snapshot_length;
+        int saving = writer->saving;
+        unsigned long generation = writer->queued;
+        int saved = 0;
+
+        writer->snapshot = NULL;
+        writer->saving = 0;
+        writer->busy = 1;
+        pthread_mutex_unlock(&writer->lock);
+
+        int unsynced = writer_journal(writer, &head);
+
+        if (saving && snapshot == NULL) {
+            if (writer_reset(writer) == -1) {
+                writer_fail(writer, "Can't reset journal: %s", strerror(errno));
+            } else {
+                unsynced |= WRITER_UNSYNCED_JOURNAL;
+            }
+        } else if (saving) {
+            if (writer_write_file(writer, snapshot, snapshot_length) == -1) {
+                writer_fail(writer, "Can't save I/O error: %s", strerror(errno));
+            } else {
+                unsynced |= WRITER_UNSYNCED_JOURNAL | WRITER_UNSYNCED_DIRECTORY;
+                saved = 1;
+            }
+        }
+
+        unsynced |= writer_journal(writer, &tail);
+
+        free(snapshot);
+        buffer_reset(&head);
+        buffer_reset(&tail);
+
+        pthread_mutex_lock(&writer->lock);
+        writer->unsynced |= unsynced;
+        if (saved) writer->saved = generation;
+
+        if (writer_due(writer)) {
+            unsynced = writer->unsynced;
+            writer->unsynced = 0;
+            pthread_mutex_unlock(&writer->lock);
+
+            writer_sync(writer, unsynced);
+
+            pthread_mutex_lock(&writer->lock);
+            clock_gettime(CLOCK_MONOTONIC, &writer->synced);
+        }
+
+        writer->busy = 0;
+
+        if (!writer_pending(writer) && !writer->unsynced) {
+            pthread_cond_broadcast(&writer->idle);
+        }
+    }
+
+    return NULL;
+}
+
+int writer_start(struct writer *writer, struct journal *journal,
+    const char *filename, int notify, int sync) {
+    writer->journal = journal;
+    writer->filename = strdup(filename);
+    writer->path = realpath(filename, NULL);
+    writer->notify = notify;
+    writer->head = (struct buffer) BUFFER_INIT;
+    writer->tail = (struct buffer) BUFFER_INIT;
+    writer->snapshot = NULL;
+    writer->saving = 0;
+    writer->queued = 0;
+    writer->saved = 0;
+    writer->busy = 0;
+    writer->flushing = 0;
+    writer->sync = sync;
+    writer->unsynced = 0;
+    writer->error = 0;
+    writer->message[0] = '\0';
+    writer->failure[0] = '\0';
+    memset(&writer->written, 0, sizeof(writer->written));
+
+    clock_gettime(CLOCK_MONOTONIC, &writer->synced);
+
+    if (writer->path == NULL && writer->filename != NULL) {
+        writer->path = strdup(writer->filename);
+    }
+
+    if (writer->filename == NULL || writer->path == NULL) return -1;
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_condattr_t monotonic;
+    pthread_condattr_init(&monotonic);
+    pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+    pthread_cond_init(&writer->changed, &monotonic);
+    pthread_cond_init(&writer->idle, &monotonic);
+    pthread_condattr_destroy(&monotonic);
+
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+
+    int error = pthread_create(&writer->thread, NULL, writer_run, writer);
+
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (error) {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+void writer_touch(struct writer *writer) {
+    clock_gettime(CLOCK_MONOTONIC, &writer->last);
+
+    if (!writer_pending(writer)) writer->first = writer->last;
+}
+
+void writer_record(struct writer *writer, const char *string, int length) {
+    pthread_mutex_lock(&writer->lock);
+    writer_touch(writer);
+    buffer_append(writer->saving ? &writer->tail : &writer->head, string, length);
+    pthread_cond_signal(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+unsigned long writer_save(struct writer *writer, char *snapshot, int length) {
+    pthread_mutex_lock(&writer->lock);
+    writer_touch(writer);
+
+    if (writer->saving) {
+        buffer_append(&writer->head, writer->tail.string, writer->tail.length);
+        buffer_reset(&writer->tail);
+        free(writer->snapshot);
+    }
+
+    writer->snapshot = snapshot;
+    writer->snapshot_length = length;
+    writer->saving = 1;
+
+    unsigned long generation = ++writer->queued;
+
+    pthread_cond_signal(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+
+    return generation;
+}
+
+void writer_flush(struct writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->flushing = 1;
+    pthread_cond_signal(&writer->changed);
+
+    while (writer_pending(writer) || writer->busy || writer->unsynced) {
+        pthread_cond_wait(&writer->idle, &writer->lock);
+    }
+
+    writer->flushing = 0;
+    pthread_mutex_unlock(&writer->lock);
+}
+
+int writer_wrote(struct writer *writer, const struct stat *st) {
+    pthread_mutex_lock(&writer->lock);
+
+    int wrote = writer->written.st_ino == st->st_ino &&
+        writer->written.st_dev == st->st_dev &&
+        writer->written.st_size == st->st_size &&
+        writer->written.st_mtim.tv_sec == st->st_mtim.tv_sec &&
+        writer->written.st_mtim.tv_nsec == st->st_mtim.tv_nsec;
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return wrote;
+}
+
+unsigned long writer_saved(struct writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+
+    unsigned long saved = writer->saved;
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return saved;
+}
+
+int writer_message(struct writer *writer, char *dest, size_t size) {
+    pthread_mutex_lock(&writer->lock);
+
+    int found = writer->message[0] != '\0';
+
+    if (found) {
+        snprintf(dest, size, "%s", writer->message);
+        writer->message[0] = '\0';
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return found;
+}
+
+int writer_error(struct writer *writer, char *dest, size_t size) {
+    pthread_mutex_lock(&writer->lock);
+
+    int error = writer->error;
+
+    if (error) {
+        snprintf(dest, size, "%s", writer->failure);
+        writer->error = 0;
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return error;
+}